@@ -0,0 +1,20 @@
+#ifndef APPLICATIVE_H
+#define APPLICATIVE_H
+#include <type_traits>
+
+namespace monad {
+    // Monads whose applicative operations can be computed directly, instead
+    // of going through >>= with a curried function per element, specialize
+    // this trait as std::true_type and provide
+    //
+    //   static auto fmap(f, const Monad<T>& x);     and for Monad<T>&&
+    //   static auto liftA2(f, const Monad<T1>& x, const Monad<T2>& y);
+    //
+    // where f is called with the plain values (f(x1), f(x1, y1)). fmap, ap,
+    // liftM and liftM2 in monad.h dispatch to these whenever f accepts the
+    // values directly.
+    template <template <typename, typename...> class Monad>
+    struct native_applicative : std::false_type {};
+} // namespace monad
+
+#endif
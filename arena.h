@@ -0,0 +1,188 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// A monotonic arena: allocations bump a pointer through blocks of growing
+// size and deallocation is a no-op. All memory is given back at once when the
+// arena is released or destroyed, which suits request-scoped pipelines that
+// build many small list nodes and drop them together.
+//
+// arena_allocator<T> allocates from an arena. A default constructed one uses
+// the arena of the innermost arena_scope on the current thread (or the global
+// heap outside of any scope), so containers created deep inside a pipeline,
+// e.g. by pure or by the empty results of >>=, end up in the arena as well:
+//
+//     monotonic_arena arena;
+//     arena_scope scope(arena);
+//     arena_list<int> xs{1, 2, 3};
+//     auto ys = xs >>= [] (int x) { return arena_list<int>{x, x}; };
+//
+// Containers must not outlive the arena they allocate from.
+class monotonic_arena {
+public:
+    explicit monotonic_arena(std::size_t initialBlockSize = 4096)
+        : _head{nullptr}
+        , _current{nullptr}
+        , _end{nullptr}
+        , _initialBlockSize{std::max<std::size_t>(initialBlockSize, 64)}
+        , _nextBlockSize{_initialBlockSize}
+        , _bytesAllocated{0} {
+    }
+
+    monotonic_arena(const monotonic_arena&) = delete;
+    monotonic_arena& operator=(const monotonic_arena&) = delete;
+
+    ~monotonic_arena() {
+        release();
+    }
+
+    void* allocate(std::size_t size, std::size_t alignment) {
+        char* ptr = align(_current, alignment);
+        if (!_current || ptr + size > _end) {
+            addBlock(size + alignment);
+            ptr = align(_current, alignment);
+        }
+        _current = ptr + size;
+        _bytesAllocated += size;
+        return ptr;
+    }
+
+    // frees all blocks, everything allocated from the arena becomes invalid
+    void release() {
+        while (_head) {
+            block* next = _head->next;
+            ::operator delete(_head);
+            _head = next;
+        }
+        _current = nullptr;
+        _end = nullptr;
+        _nextBlockSize = _initialBlockSize;
+        _bytesAllocated = 0;
+    }
+
+    std::size_t bytes_allocated() const {
+        return _bytesAllocated;
+    }
+
+    // the arena of the innermost arena_scope of the calling thread
+    static monotonic_arena*& current() {
+        static thread_local monotonic_arena* arena = nullptr;
+        return arena;
+    }
+
+private:
+    struct block {
+        block* next;
+    };
+
+    static char* align(char* ptr, std::size_t alignment) {
+        auto address = reinterpret_cast<std::uintptr_t>(ptr);
+        return reinterpret_cast<char*>((address + alignment - 1) & ~(alignment - 1));
+    }
+
+    // blocks double in size so the number of blocks stays logarithmic
+    void addBlock(std::size_t minSize) {
+        std::size_t size = std::max(_nextBlockSize, minSize + sizeof(block));
+        _nextBlockSize = 2 * size;
+        _head = ::new (::operator new(size)) block{_head};
+        _current = reinterpret_cast<char*>(_head + 1);
+        _end = reinterpret_cast<char*>(_head) + size;
+    }
+
+    block* _head;
+    char* _current;
+    char* _end;
+    std::size_t _initialBlockSize;
+    std::size_t _nextBlockSize;
+    std::size_t _bytesAllocated;
+};
+
+// makes arena the arena of default constructed arena_allocators on this
+// thread until the scope ends
+class arena_scope {
+public:
+    explicit arena_scope(monotonic_arena& arena)
+        : _previous{monotonic_arena::current()} {
+        monotonic_arena::current() = &arena;
+    }
+
+    arena_scope(const arena_scope&) = delete;
+    arena_scope& operator=(const arena_scope&) = delete;
+
+    ~arena_scope() {
+        monotonic_arena::current() = _previous;
+    }
+
+private:
+    monotonic_arena* _previous;
+};
+
+template <typename T>
+class arena_allocator {
+public:
+    using value_type = T;
+    // containers take their allocator along on assignment and swap, so
+    // values moved out of a scope keep pointing to their arena
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    arena_allocator() noexcept
+        : _arena{monotonic_arena::current()} {
+    }
+
+    arena_allocator(monotonic_arena& arena) noexcept
+        : _arena{&arena} {
+    }
+
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept
+        : _arena{other.arena()} {
+    }
+
+    T* allocate(std::size_t n) {
+        if (_arena) {
+            return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, std::size_t) noexcept {
+        if (!_arena) {
+            ::operator delete(ptr);
+        }
+    }
+
+    // the arena allocated from, nullptr for the global heap
+    monotonic_arena* arena() const noexcept {
+        return _arena;
+    }
+
+private:
+    monotonic_arena* _arena;
+};
+
+template <typename T, typename U>
+bool operator==(const arena_allocator<T>& a1, const arena_allocator<U>& a2) noexcept {
+    return a1.arena() == a2.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T>& a1, const arena_allocator<U>& a2) noexcept {
+    return !(a1 == a2);
+}
+
+template <typename T>
+using arena_list = std::list<T, arena_allocator<T>>;
+
+template <typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
+
+#endif
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Assembly check for the lifted optional operations.
+
+Compiles liftM2<optional>(std::plus<>{}) and the hand-written null check
+
+  x.is_nothing() || y.is_nothing() ? optional<int>{} : optional<int>{*x + *y}
+
+to assembly and compares the two functions. They match if the lifted version
+calls nothing and performs the same branches and arithmetic in the same
+order. Plain moves are not compared: the compilers store the flag and the
+value of the returned optional in different but equivalent ways. Builds
+with -DMONAD_INSTRUMENT add the counters and don't match.
+
+Usage:
+  ./asm_check.py [--cxx g++] [--flags "-std=c++14 -O2"]
+"""
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+SOURCE = """#include "list.h"
+#include "monad.h"
+#include "optional.h"
+#include <functional>
+
+optional<int> lifted(const optional<int>& x, const optional<int>& y) {
+    return monad::liftM2<optional>(std::plus<>{})(x, y);
+}
+
+optional<int> by_hand(const optional<int>& x, const optional<int>& y) {
+    return x.is_nothing() || y.is_nothing() ? optional<int>{} : optional<int>{*x + *y};
+}
+"""
+
+# instructions that make up the shape of a function, everything else moves data
+SHAPE = re.compile(r"^(j\w+|call\w*|ret\w*|add\w*|sub\w*|imul\w*|cmp\w*|test\w*)$")
+
+
+def function_body(assembly, name):
+    body = []
+    inside = False
+    for line in assembly.splitlines():
+        if re.match(r"^_?\w*{}\w*:".format(name), line):
+            inside = True
+            continue
+        if inside:
+            stripped = line.strip()
+            if stripped.startswith(".cfi") or not stripped or stripped.endswith(":"):
+                continue
+            if stripped.startswith(".size") or stripped.startswith(".section") or stripped.startswith(".globl"):
+                break
+            if not stripped.startswith("."):
+                body.append(stripped)
+    return body
+
+
+def shape(body):
+    mnemonics = (instruction.split()[0] for instruction in body)
+    return [mnemonic for mnemonic in mnemonics if SHAPE.match(mnemonic)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "g++"))
+    parser.add_argument("--flags", default="-std=c++14 -O2", help="compiler flags (default: %(default)s)")
+    args = parser.parse_args()
+
+    repo = os.path.dirname(os.path.abspath(__file__))
+    with tempfile.TemporaryDirectory() as workdir:
+        source_file = os.path.join(workdir, "asm_check.cpp")
+        with open(source_file, "w") as out:
+            out.write(SOURCE)
+        command = [args.cxx] + args.flags.split() + ["-I", repo, "-S", "-o", "-", source_file]
+        assembly = subprocess.run(command, stdout=subprocess.PIPE, universal_newlines=True, check=True).stdout
+
+    lifted = function_body(assembly, "lifted")
+    by_hand = function_body(assembly, "by_hand")
+    print("liftM2<optional>: {} instructions, shape {}".format(len(lifted), " ".join(shape(lifted))))
+    print("hand-written:     {} instructions, shape {}".format(len(by_hand), " ".join(shape(by_hand))))
+    if any(mnemonic.startswith("call") for mnemonic in shape(lifted)) or shape(lifted) != shape(by_hand):
+        print("\nliftM2<optional>:\n    " + "\n    ".join(lifted))
+        print("\nhand-written:\n    " + "\n    ".join(by_hand))
+        sys.exit("liftM2<optional> doesn't compile to the hand-written null check")
+    print("OK")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,752 @@
+// Runtime micro benchmarks for the monad primitives.
+//
+// Build and run with e.g.
+//     g++ -std=c++14 -O2 -pthread benchmark.cpp -o benchmark && ./benchmark
+//
+// For every case the table shows the time per operation, the number of heap
+// allocations per operation (counted by replacing the global operator new)
+// and the number of payload bytes copied per operation (counted by the
+// instrumented payload type below). An optional argument restricts the run to
+// the cases whose name contains it.
+//
+// Built with -std=c++20 the do-notation of coroutine.h is compared against
+// the equivalent >>= chains as well.
+#include "arena.h"
+#include "concurrent_log.h"
+#include "list.h"
+#include "vector.h"
+#include "monad.h"
+#include "coroutine.h"
+#include "expected.h"
+#include "function.h"
+#include "log_sink.h"
+#include "monoid.h"
+#include "optional.h"
+#include "parallel.h"
+#include "stream.h"
+#include "task.h"
+#include "writer.h"
+#include "writer_t.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+    std::atomic<std::size_t> allocationCount{0};
+    std::atomic<std::size_t> bytesCopied{0};
+
+    // std::free called through a pointer the compiler can't see through:
+    // once the replaced operator delete is inlined into a delete expression,
+    // g++ would otherwise see free() on memory from operator new and warn
+    // with -Wmismatched-new-delete
+    void (*volatile releaseMemory)(void*) = std::free;
+
+    void* countedAllocate(std::size_t size) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        if (void* ptr = std::malloc(size ? size : 1)) {
+            return ptr;
+        }
+        throw std::bad_alloc{};
+    }
+} // namespace
+
+void* operator new(std::size_t size) {
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return countedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    releaseMemory(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    releaseMemory(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    releaseMemory(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    releaseMemory(ptr);
+}
+
+#ifdef __cpp_aligned_new
+namespace {
+    void* countedAllocate(std::size_t size, std::align_val_t alignment) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        const std::size_t align = static_cast<std::size_t>(alignment);
+        // aligned_alloc wants a non-zero multiple of the alignment
+        if (void* ptr = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align)) {
+            return ptr;
+        }
+        throw std::bad_alloc{};
+    }
+} // namespace
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAllocate(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedAllocate(size, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    releaseMemory(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    releaseMemory(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    releaseMemory(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+    releaseMemory(ptr);
+}
+#endif
+
+namespace {
+    // a value type that counts the bytes copied whenever it is copied
+    struct payload {
+        payload(int val = 0)
+            : value{val} {
+        }
+
+        payload(const payload& other)
+            : value{other.value} {
+            std::memcpy(padding, other.padding, sizeof(padding));
+            bytesCopied.fetch_add(sizeof(payload), std::memory_order_relaxed);
+        }
+
+        payload(payload&&) = default;
+
+        payload& operator=(const payload& other) {
+            value = other.value;
+            std::memcpy(padding, other.padding, sizeof(padding));
+            bytesCopied.fetch_add(sizeof(payload), std::memory_order_relaxed);
+            return *this;
+        }
+
+        payload& operator=(payload&&) = default;
+
+        payload operator+(const payload& other) const {
+            return payload{value + other.value};
+        }
+
+        int value;
+        char padding[60] = {};
+    };
+
+    template <typename T>
+    void do_not_optimize(const T& val) {
+        asm volatile("" : : "g"(&val) : "memory");
+    }
+
+    // hides x from the optimizer, so work depending on it isn't folded away
+    int opaque(int x) {
+        asm volatile("" : "+r"(x));
+        return x;
+    }
+
+    const char* filter = nullptr;
+
+    // runs op iterations times and prints the per operation costs
+    template <typename Op>
+    void run(const char* name, std::size_t iterations, Op&& op) {
+        if (filter && !std::strstr(name, filter)) {
+            return;
+        }
+        // warm up caches and the allocator's free lists, otherwise the first
+        // case in a run is noticeably slower
+        for (std::size_t i = 0; i < iterations / 10 + 1; i++) {
+            op();
+        }
+        std::size_t allocationsBefore = allocationCount.load();
+        std::size_t copiedBefore = bytesCopied.load();
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; i++) {
+            op();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+        std::printf("%-44s %14.1f %12.2f %14.1f\n", name,
+                    ns / iterations,
+                    double(allocationCount.load() - allocationsBefore) / iterations,
+                    double(bytesCopied.load() - copiedBefore) / iterations);
+    }
+
+    std::list<payload> payloadList(int size) {
+        std::list<payload> returnList{};
+        for (int i = 0; i < size; i++) {
+            returnList.push_back(payload{i});
+        }
+        return returnList;
+    }
+
+    auto logStep = [] (const payload& x) {
+        return monad::Writer::writer(payload{x.value + 1}, rope<std::string>{"step"});
+    };
+
+    optional<int> halve(int x) {
+        return x % 2 == 0 ? optional<int>{x / 2} : optional<int>{};
+    }
+
+    // halve with a log entry, once as Writer<optional<int>> and once as
+    // WriterT over optional
+    monad::Writer::Writer<optional<int>> halveLoggedNested(const optional<int>& x) {
+        if (x.is_nothing()) {
+            return monad::Writer::writer(optional<int>{}, rope<std::string>{});
+        }
+        return monad::Writer::writer(halve(*x), rope<std::string>{"halve"});
+    }
+
+    monad::Writer::WriterT<int> halveLogged(int x) {
+        if (x % 2 != 0) {
+            return optional<int>{};
+        }
+        return {x / 2, rope<std::string>{"halve"}};
+    }
+
+    optional<int> halveFourTimesBind(int x) {
+        return halve(x) >>= [] (int a) {
+            return halve(a) >>= [] (int b) {
+                return halve(b) >>= [] (int c) {
+                    return halve(c) >>= [c] (int d) { return optional<int>{c + d}; };
+                };
+            };
+        };
+    }
+
+    Expected<int> halveExpected(int x) {
+        if (x % 2 != 0) {
+            return make_unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+        return x / 2;
+    }
+
+    Expected<int> halveFourTimesExpected(int x) {
+        return halveExpected(x) >>= [] (int a) {
+            return halveExpected(a) >>= [] (int b) {
+                return halveExpected(b) >>= [] (int c) {
+                    return halveExpected(c) >>= [c] (int d) { return Expected<int>{c + d}; };
+                };
+            };
+        };
+    }
+
+    int halveThrowing(int x) {
+        if (x % 2 != 0) {
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+        }
+        return x / 2;
+    }
+
+    // the same computation with the error reported by an exception
+    Expected<int> halveFourTimesThrowing(int x) {
+        try {
+            int a = halveThrowing(x);
+            int b = halveThrowing(a);
+            int c = halveThrowing(b);
+            int d = halveThrowing(c);
+            return c + d;
+        } catch (const std::system_error& e) {
+            return make_unexpected(e.code());
+        }
+    }
+
+    auto logPayload(const payload& x) {
+        return monad::Writer::writer(payload{x.value + 1}, rope<std::string>{"step"});
+    }
+
+    auto logFourTimesBind(const payload& x) {
+        return logPayload(x) >>= [] (const payload& a) {
+            return logPayload(a) >>= [] (const payload& b) {
+                return logPayload(b) >>= [b] (const payload& c) {
+                    return logPayload(c) >>= [b] (const payload& d) {
+                        return monad::Writer::writer(b + d, rope<std::string>{});
+                    };
+                };
+            };
+        };
+    }
+
+#ifdef __cpp_impl_coroutine
+    do_block<optional<int>> halveFourTimesDo(int x) {
+        int a = co_await halve(x);
+        int b = co_await halve(a);
+        int c = co_await halve(b);
+        int d = co_await halve(c);
+        co_return c + d;
+    }
+
+    do_block<monad::Writer::Writer<payload>> logFourTimesDo(const payload& x) {
+        payload a = co_await logPayload(x);
+        payload b = co_await logPayload(a);
+        payload c = co_await logPayload(b);
+        payload d = co_await logPayload(c);
+        co_return b + d;
+    }
+#endif
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        filter = argv[1];
+    }
+    std::printf("%-44s %14s %12s %14s\n", "case", "ns/op", "allocs/op", "bytes copied/op");
+
+    /*************************************
+     *      curry                        *
+     *************************************/
+    auto add3 = [] (const payload& a, const payload& b, const payload& c) { return a + b + c; };
+    payload p1{1}, p2{2}, p3{3};
+    run("curry: partial application lvalues", 1000000, [&] {
+        do_not_optimize(curry(add3)(p1)(p2)(p3));
+    });
+    run("curry: partial application rvalues", 1000000, [&] {
+        do_not_optimize(curry(add3)(payload{1})(payload{2})(payload{3}));
+    });
+
+    /*************************************
+     *      optional                     *
+     *************************************/
+    optional<payload> someOpt{payload{41}};
+    optional<payload> noneOpt{};
+    run("optional: pure", 1000000, [&] {
+        do_not_optimize(monad::pure<optional>(payload{1}));
+    });
+    run("optional: fmap", 1000000, [&] {
+        do_not_optimize(monad::fmap([] (const payload& x) { return x.value + 1; }, someOpt));
+    });
+    run("optional: ap", 1000000, [&] {
+        do_not_optimize(monad::ap(monad::pure<optional>([] (const payload& x) { return x.value; }), someOpt));
+    });
+    run("optional: join", 1000000, [&] {
+        optional<optional<int>> nested{optional<int>{1}};
+        do_not_optimize(monad::join(nested));
+    });
+    run("optional: liftM", 1000000, [&] {
+        do_not_optimize(monad::liftM<optional>([] (const payload& x) { return x.value; })(someOpt));
+    });
+    run("optional: liftM2", 1000000, [&] {
+        do_not_optimize(monad::liftM2<optional>(std::plus<>{})(someOpt, someOpt));
+    });
+    run("optional: liftM2 nothing", 1000000, [&] {
+        do_not_optimize(monad::liftM2<optional>(std::plus<>{})(someOpt, noneOpt));
+    });
+    // what liftM2 should compile to, see asm_check.py
+    auto sumByHand = [] (const optional<payload>& x, const optional<payload>& y) {
+        return x.is_nothing() || y.is_nothing() ? optional<payload>{} : optional<payload>{*x + *y};
+    };
+    run("optional: hand-written null check", 1000000, [&] {
+        do_not_optimize(sumByHand(someOpt, someOpt));
+    });
+    run("optional: hand-written null check nothing", 1000000, [&] {
+        do_not_optimize(sumByHand(someOpt, noneOpt));
+    });
+    std::vector<int> divisors(1000, 1);
+    divisors[10] = 0;
+    run("optional: foldM 1000, nothing after 10", 100000, [&] {
+        do_not_optimize(monad::foldM([] (int acc, int x) { return x == 0 ? optional<int>{} : optional<int>{acc / x}; }, 1000, divisors));
+    });
+    run("optional: 4 steps, >>= chain", 1000000, [&] {
+        do_not_optimize(halveFourTimesBind(48));
+    });
+#ifdef __cpp_impl_coroutine
+    run("optional: 4 steps, co_await", 1000000, [&] {
+        do_not_optimize(halveFourTimesDo(48).run());
+    });
+#endif
+
+    /*************************************
+     *      Expected                     *
+     *************************************/
+    // the runtime allocates the exception objects with malloc, which the
+    // allocation count doesn't see
+    run("Expected: 4 steps, success", 1000000, [&] {
+        do_not_optimize(halveFourTimesExpected(opaque(48)));
+    });
+    run("Expected: 4 steps, error in step 1", 1000000, [&] {
+        do_not_optimize(halveFourTimesExpected(opaque(47)));
+    });
+    run("exceptions: 4 steps, success", 1000000, [&] {
+        do_not_optimize(halveFourTimesThrowing(opaque(48)));
+    });
+    run("exceptions: 4 steps, error in step 1", 1000000, [&] {
+        do_not_optimize(halveFourTimesThrowing(opaque(47)));
+    });
+    Expected<payload> someExpected{payload{41}};
+    Expected<payload> errorExpected{make_unexpected(std::make_error_code(std::errc::invalid_argument))};
+    run("Expected: liftM2", 1000000, [&] {
+        do_not_optimize(monad::liftM2<Expected>(std::plus<>{})(someExpected, someExpected));
+    });
+    run("Expected: liftM2 error", 1000000, [&] {
+        do_not_optimize(monad::liftM2<Expected>(std::plus<>{})(someExpected, errorExpected));
+    });
+    run("Expected: foldM 1000, error after 10", 100000, [&] {
+        do_not_optimize(monad::foldM([] (int acc, int x) {
+            return x == 0 ? Expected<int>{make_unexpected(std::make_error_code(std::errc::result_out_of_range))} : Expected<int>{acc / x};
+        }, 1000, divisors));
+    });
+
+    /*************************************
+     *      std::list                    *
+     *************************************/
+    auto list100 = payloadList(100);
+    auto list10 = payloadList(10);
+    run("list: pure", 1000000, [&] {
+        do_not_optimize(monad::pure<std::list>(payload{1}));
+    });
+    run("list: fmap 100", 100000, [&] {
+        do_not_optimize(monad::fmap([] (const payload& x) { return x.value; }, list100));
+    });
+    run("list: ap 10x10", 100000, [&] {
+        do_not_optimize(monad::ap(monad::fmap(std::plus<>{}, list10), list10));
+    });
+    run("list: join 10x10", 100000, [&] {
+        std::list<std::list<payload>> nested(10, list10);
+        do_not_optimize(monad::join(nested));
+    });
+    run("list: join 10x10 rvalue", 100000, [&] {
+        std::list<std::list<payload>> nested(10, list10);
+        do_not_optimize(monad::join(std::move(nested)));
+    });
+    run("list: >>= 100, 10 new elements each", 10000, [&] {
+        do_not_optimize(list100 >>= [] (const payload& x) { return std::list<payload>(10, x); });
+    });
+    run("list: liftM 100", 100000, [&] {
+        do_not_optimize(monad::liftM<std::list>([] (const payload& x) { return x.value; })(list100));
+    });
+    run("list: liftM2 10x10", 100000, [&] {
+        do_not_optimize(monad::liftM2<std::list>(std::plus<>{})(list10, list10));
+    });
+    run("list: liftM2 10x10 generic (via ap)", 100000, [&] {
+        do_not_optimize(monad::liftM2Impl<std::list>(std::false_type{}, std::plus<>{}, list10, list10));
+    });
+
+    // a lazy stream pipeline, fused into a single pass when collected
+    std::vector<int> streamInput(1000, 1);
+    run("stream: fmap and bind 1000 elements", 1000, [&] {
+        auto doubled = monad::fmap([] (int x) { return x * 2; }, make_stream(streamInput));
+        do_not_optimize((std::move(doubled) >>= [] (int x) { return stream<int>{x, x + 1}; }).to_vector());
+    });
+
+    // a request-scoped pipeline of binds and fmaps, once on the global heap
+    // and once out of a monotonic arena that is released after each run
+    run("list: pipeline 100x10, default allocator", 10000, [&] {
+        std::list<int> xs(100, 1);
+        auto ys = xs >>= [] (int x) { return std::list<int>(10, x); };
+        auto zs = monad::fmap([] (int x) { return x + 1; }, ys);
+        do_not_optimize(zs >>= [] (int x) { return std::list<int>{x, x}; });
+    });
+    monotonic_arena arena;
+    run("list: pipeline 100x10, monotonic arena", 10000, [&] {
+        {
+            arena_scope scope(arena);
+            arena_list<int> xs(100, 1);
+            auto ys = xs >>= [] (int x) { return arena_list<int>(10, x); };
+            auto zs = monad::fmap([] (int x) { return x + 1; }, ys);
+            do_not_optimize(zs >>= [] (int x) { return arena_list<int>{x, x}; });
+        }
+        arena.release();
+    });
+
+    // sumList and sumOfSquaresList from ex01.cpp, native and through >>=
+    std::list<int> ints{1, 2, 3, 4, 5, 6, 7, 8};
+    auto square = [] (int x) { return x * x; };
+    run("list: sumOfSquaresList native", 100000, [&] {
+        auto squareList = monad::liftM<std::list>(square);
+        do_not_optimize(monad::liftM2<std::list>(std::plus<>{})(squareList(ints), squareList(ints)));
+    });
+    run("list: sumOfSquaresList generic", 100000, [&] {
+        auto squared = monad::liftMImpl<std::list>(std::false_type{}, square, ints);
+        do_not_optimize(monad::liftM2Impl<std::list>(std::false_type{}, std::plus<>{}, squared, squared));
+    });
+
+    /*************************************
+     *      Writer                       *
+     *************************************/
+    using namespace monad::Writer;
+    auto someWriter = writer(payload{1}, rope<std::string>{"one"});
+    run("Writer: pure", 1000000, [&] {
+        do_not_optimize(monad::pure<Writer>(payload{1}));
+    });
+    run("Writer: fmap", 1000000, [&] {
+        do_not_optimize(monad::fmap([] (const payload& x) { return x.value; }, someWriter));
+    });
+    run("Writer: ap", 1000000, [&] {
+        do_not_optimize(monad::ap(monad::pure<Writer>([] (const payload& x) { return x.value; }), someWriter));
+    });
+    run("Writer: liftM", 1000000, [&] {
+        do_not_optimize(monad::liftM<Writer>([] (const payload& x) { return x.value; })(someWriter));
+    });
+    run("Writer: liftM2", 1000000, [&] {
+        do_not_optimize(monad::liftM2<Writer>(std::plus<>{})(someWriter, someWriter));
+    });
+    run("Writer: 4 steps, >>= chain", 1000000, [&] {
+        do_not_optimize(logFourTimesBind(payload{1}));
+    });
+#ifdef __cpp_impl_coroutine
+    run("Writer: 4 steps, co_await", 1000000, [&] {
+        do_not_optimize(logFourTimesDo(payload{1}).run());
+    });
+#endif
+    run("Writer: 1000 binds, lvalue", 100, [&] {
+        auto computation = someWriter;
+        for (int i = 0; i < 1000; i++) {
+            computation = computation >>= logStep;
+        }
+        do_not_optimize(runWriter(computation));
+    });
+    run("Writer: 1000 binds, rvalue", 100, [&] {
+        auto computation = someWriter;
+        for (int i = 0; i < 1000; i++) {
+            computation = std::move(computation) >>= logStep;
+        }
+        do_not_optimize(runWriter(std::move(computation)));
+    });
+    run("Writer: iterateM 1000 steps", 100, [&] {
+        do_not_optimize(runWriter(monad::iterateM(1000, logStep, someWriter)));
+    });
+    run("Writer: iterateM 1000 steps, int log", 1000, [&] {
+        auto count = [] (const payload& x) { return writer(payload{x.value + 1}, 1); };
+        do_not_optimize(runWriter(monad::iterateM(1000, count, writer(payload{0}, 0))));
+    });
+    ring_sink ring(256);
+    auto logToRing = [&ring] (const payload& x) { return writer(payload{x.value + 1}, log_to(ring, "step")); };
+    run("Writer: iterateM 1000 steps, ring_sink log", 100, [&] {
+        do_not_optimize(runWriter(monad::iterateM(1000, logToRing, writer(payload{0}, sink_log{}))));
+    });
+    // a long run: the rope log allocates a node per step and keeps every
+    // one of them until runWriter, while the sink_log writes each entry to
+    // the ring as it is told and allocates nothing, so its memory stays flat
+    // however many steps run
+    run("Writer: iterateM 100000 steps, rope log", 10, [&] {
+        do_not_optimize(runWriter(monad::iterateM(100000, logStep, someWriter)));
+    });
+    run("Writer: iterateM 100000 steps, ring_sink log", 10, [&] {
+        do_not_optimize(runWriter(monad::iterateM(100000, logToRing, writer(payload{0}, sink_log{}))));
+    });
+    run("Writer: 1000 binds, std::list log", 100, [&] {
+        auto computation = writer(payload{1}, std::list<std::string>{"one"});
+        for (int i = 0; i < 1000; i++) {
+            computation = std::move(computation) >>= [] (const payload& x) {
+                return writer(payload{x.value + 1}, std::list<std::string>{"step"});
+            };
+        }
+        do_not_optimize(runWriter(std::move(computation)));
+    });
+    run("Writer<optional>: 4 steps, success", 1000000, [&] {
+        do_not_optimize(monad::iterateM(4, halveLoggedNested, writer(optional<int>{48}, rope<std::string>{})));
+    });
+    run("WriterT<optional>: 4 steps, success", 1000000, [&] {
+        do_not_optimize(monad::iterateM(4, halveLogged, WriterT<int>{48}));
+    });
+    run("Writer<optional>: 4 steps, failure in step 1", 1000000, [&] {
+        do_not_optimize(monad::iterateM(4, halveLoggedNested, writer(optional<int>{3}, rope<std::string>{})));
+    });
+    run("WriterT<optional>: 4 steps, failure in step 1", 1000000, [&] {
+        do_not_optimize(monad::iterateM(4, halveLogged, WriterT<int>{3}));
+    });
+
+    /*************************************
+     *      runtime pipelines            *
+     *************************************/
+    // 8 steps assembled at runtime, each a curried_fn capturing its name and
+    // a bonus, which is too large for the buffer of std::function
+    auto stepFn = curry([] (const std::string& name, int bonus, int x) {
+        return name.empty() ? optional<int>{} : optional<int>{x + bonus};
+    });
+    const std::string stepName = "step";
+    run("Pipeline: 8 steps, std::function", 100000, [&] {
+        std::vector<std::function<optional<int>(int)>> steps{};
+        steps.reserve(8);
+        for (int i = 0; i < 8; i++) {
+            steps.push_back(stepFn(stepName)(i));
+        }
+        optional<int> x{0};
+        for (const auto& step : steps) {
+            x = std::move(x) >>= step;
+        }
+        do_not_optimize(x);
+    });
+    run("Pipeline: 8 steps, unique_function", 100000, [&] {
+        Pipeline<optional, int> pipeline{};
+        pipeline.reserve(8);
+        for (int i = 0; i < 8; i++) {
+            pipeline.then(stepFn(stepName)(i));
+        }
+        do_not_optimize(pipeline(optional<int>{0}));
+    });
+
+    /*************************************
+     *      vectorized fmap / liftM2     *
+     *************************************/
+    std::vector<float> scores(1000);
+    for (std::size_t i = 0; i < scores.size(); i++) {
+        scores[i] = 0.001f * i;
+    }
+    auto scalarPlus = [] (float x, float y) { return x + y; };
+    run("vector: liftM2 1000x1000 float, lambda", 100, [&] {
+        do_not_optimize(monad::liftM2<std::vector>(scalarPlus)(scores, scores));
+    });
+    run("vector: liftM2 1000x1000 float, std::plus<>", 100, [&] {
+        do_not_optimize(monad::liftM2<std::vector>(std::plus<>{})(scores, scores));
+    });
+    run("vector: liftM2 1000x1000 float, simd_safe", 100, [&] {
+        do_not_optimize(monad::liftM2<std::vector>(simd_safe(scalarPlus))(scores, scores));
+    });
+    std::vector<float> manyScores(1000000, 1.5f);
+    auto squareScore = [] (float x) { return x * x; };
+    run("vector: fmap square 1M float, lambda", 100, [&] {
+        do_not_optimize(monad::fmap(squareScore, manyScores));
+    });
+    run("vector: fmap square 1M float, simd_safe", 100, [&] {
+        do_not_optimize(monad::fmap(simd_safe(squareScore), manyScores));
+    });
+    run("vector: fmap negate 1M float, std::negate<>", 100, [&] {
+        do_not_optimize(monad::fmap(std::negate<>{}, manyScores));
+    });
+
+    /*************************************
+     *      Task                         *
+     *************************************/
+    auto lookup = [] (int key) {
+        return spawn([key] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return key;
+        });
+    };
+    run("Task: two 1ms lookups, one after another", 100, [&] {
+        int first = lookup(1).get();
+        do_not_optimize(first + lookup(2).get());
+    });
+    run("Task: two 1ms lookups, liftM2", 100, [&] {
+        do_not_optimize(monad::liftM2<Task>(std::plus<>{})(lookup(1), lookup(2)).get());
+    });
+
+    /*************************************
+     *      par_bind scaling             *
+     *************************************/
+    std::vector<int> work(2000);
+    for (int i = 0; i < 2000; i++) {
+        work[i] = i;
+    }
+    auto score = [] (int x) {
+        double acc = x;
+        for (int i = 0; i < 2000; i++) {
+            acc = acc * 1.0000001 + i;
+        }
+        return std::vector<double>{acc};
+    };
+    run("vector: bind 2000 expensive", 10, [&] {
+        do_not_optimize(work >>= score);
+    });
+    // up to four times as many threads as cores, to see what oversubscribing
+    // the cores costs
+    const std::size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1; threads <= 4 * maxThreads; threads *= 2) {
+        thread_pool pool(threads);
+        std::string name = "vector: par_bind 2000 expensive, " + std::to_string(threads) + " threads";
+        run(name.c_str(), 10, [&] {
+            do_not_optimize(par_bind(work, score, pool));
+        });
+    }
+
+    /*************************************
+     *      concurrent Writer logs       *
+     *************************************/
+    // every thread tells 10000 entries, then the Writers of all threads are
+    // combined with liftM2 in thread order
+    const int tellsPerThread = 10000;
+    for (std::size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        std::string name = "Writer: " + std::to_string(threads) + " threads x 10000 tells, list log + mutex";
+        run(name.c_str(), 10, [&] {
+            std::mutex mutex;
+            auto combined = writer(0, std::list<std::string>{});
+            std::vector<std::thread> workers{};
+            for (std::size_t t = 0; t < threads; t++) {
+                workers.emplace_back([&] {
+                    auto step = [] (int x) { return writer(x + 1, std::list<std::string>{"step"}); };
+                    auto partial = monad::iterateM(tellsPerThread, step, writer(0, std::list<std::string>{}));
+                    std::lock_guard<std::mutex> lock(mutex);
+                    combined = monad::liftM2<Writer>(std::plus<>{})(combined, partial);
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            do_not_optimize(runWriter(std::move(combined)));
+        });
+        name = "Writer: " + std::to_string(threads) + " threads x 10000 tells, concurrent_log";
+        run(name.c_str(), 10, [&] {
+            log_collector collector;
+            std::vector<Writer<int, concurrent_log>> partials(threads, writer(0, concurrent_log{}));
+            std::vector<std::thread> workers{};
+            for (std::size_t t = 0; t < threads; t++) {
+                workers.emplace_back([&, t] {
+                    auto step = [&collector] (int x) { return writer(x + 1, log_to(collector, "step")); };
+                    partials[t] = monad::iterateM(tellsPerThread, step, writer(0, concurrent_log{}));
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            auto combined = writer(0, concurrent_log{});
+            for (const auto& partial : partials) {
+                combined = monad::liftM2<Writer>(std::plus<>{})(combined, partial);
+            }
+            do_not_optimize(runWriter(std::move(combined)));
+        });
+    }
+
+    /*************************************
+     *       reducing many logs          *
+     *************************************/
+    // 2000 logs of 4 entries, as collected at the end of a batch
+    std::vector<std::list<std::string>> logs(2000, std::list<std::string>{"a", "b", "c", "d"});
+    run("monoid: 2000 list logs, left fold", 10, [&] {
+        std::list<std::string> total{};
+        for (const auto& log : logs) {
+            total = total + log;
+        }
+        do_not_optimize(total);
+    });
+    run("monoid: 2000 list logs, mconcat", 10, [&] {
+        do_not_optimize(mconcat(logs));
+    });
+    std::vector<std::string> texts(2000, std::string(64, 'x'));
+    run("monoid: 2000 strings, left fold", 10, [&] {
+        std::string total{};
+        for (const auto& text : texts) {
+            total = total + text;
+        }
+        do_not_optimize(total);
+    });
+    run("monoid: 2000 strings, mconcat", 10, [&] {
+        do_not_optimize(mconcat(texts));
+    });
+    for (std::size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        thread_pool pool(threads);
+        std::string name = "monoid: 2000 list logs, par_mconcat, " + std::to_string(threads) + " threads";
+        run(name.c_str(), 10, [&] {
+            do_not_optimize(par_mconcat(logs, pool));
+        });
+    }
+}
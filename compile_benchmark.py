@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Compile-time benchmark for deep template pipelines.
+
+Generates translation units that exercise the expensive template machinery of
+these headers with growing depth and compiles each of them, recording
+
+  * the wall clock compile time,
+  * the peak memory (max RSS) of the compiler process,
+  * the number of template instantiations (clang, via -ftime-trace) or, for
+    other compilers, the number of symbols in the object file as a proxy.
+
+Pipelines:
+  bind     a Writer >>= chain with a distinct lambda per step
+  curry    an n-ary function curried and applied one argument at a time
+  liftM2   liftM2 over optional, nested n levels deep
+  nested   Writer values nested n levels deep, flattened with >>=
+
+Usage:
+  ./compile_benchmark.py [--cxx g++] [--depths 1,2,4,8,16,32] [--pipelines bind,curry]
+"""
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+HEADER = """#include "list.h"
+#include "monad.h"
+#include "optional.h"
+#include "writer.h"
+#include <functional>
+#include <string>
+"""
+
+
+# >>= is right associative in C++, so every step of a chain is parenthesized
+def chain(start, steps):
+    expr = start
+    for step in steps:
+        expr = "({}\n        >>= {})".format(expr, step)
+    return expr
+
+
+def bind_pipeline(depth):
+    steps = ["[] (int x) {{ return monad::Writer::writer(x + {0}, rope<std::string>{{\"step {0}\"}}); }}".format(i)
+             for i in range(depth)]
+    return HEADER + """
+int run() {{
+    auto w = {chain};
+    return monad::Writer::runWriter(w).first;
+}}
+""".format(chain=chain("monad::Writer::writer(0, rope<std::string>{})", steps))
+
+
+def curry_pipeline(depth):
+    params = ", ".join("int a{}".format(i) for i in range(depth))
+    body = " + ".join("a{}".format(i) for i in range(depth))
+    calls = "".join("({})".format(i) for i in range(depth))
+    return HEADER + """
+int sum({params}) {{ return {body}; }}
+
+int run() {{
+    auto generic = curry([] ({auto_params}) {{ return {body}; }});
+    return curry(sum){calls} + generic{calls};
+}}
+""".format(params=params, body=body, calls=calls,
+           auto_params=", ".join("auto a{}".format(i) for i in range(depth)))
+
+
+def liftM2_pipeline(depth):
+    expr = "monad::pure<optional>(0)"
+    for i in range(depth):
+        expr = "sumOpt({}, monad::pure<optional>({}))".format(expr, i)
+    return HEADER + """
+int run() {{
+    auto sumOpt = monad::liftM2<optional>(std::plus<>{{}});
+    auto res = {expr};
+    return res.is_nothing() ? 0 : *res;
+}}
+""".format(expr=expr)
+
+
+def nested_pipeline(depth):
+    value = "monad::Writer::writer(0, rope<std::string>{\"inner\"})"
+    for i in range(depth):
+        value = "monad::Writer::writer({}, rope<std::string>{{\"level {}\"}})".format(value, i)
+    return HEADER + """
+int run() {{
+    auto w = {chain};
+    return monad::Writer::runWriter(w).first;
+}}
+""".format(chain=chain(value, ["[] (auto x) { return x; }"] * depth))
+
+
+PIPELINES = {
+    "bind": bind_pipeline,
+    "curry": curry_pipeline,
+    "liftM2": liftM2_pipeline,
+    "nested": nested_pipeline,
+}
+
+
+def is_clang(cxx):
+    version = subprocess.run([cxx, "--version"], stdout=subprocess.PIPE, universal_newlines=True).stdout
+    return "clang" in version
+
+
+def count_instantiations(trace_file):
+    with open(trace_file) as trace:
+        events = json.load(trace)["traceEvents"]
+    return sum(1 for event in events if event.get("name", "").startswith("Instantiate"))
+
+
+def count_symbols(object_file):
+    nm = shutil.which("nm")
+    if not nm:
+        return None
+    symbols = subprocess.run([nm, object_file], stdout=subprocess.PIPE, universal_newlines=True).stdout
+    return len(symbols.splitlines())
+
+
+def compile_once(cxx, flags, source, workdir, clang):
+    source_file = os.path.join(workdir, "pipeline.cpp")
+    object_file = os.path.join(workdir, "pipeline.o")
+    with open(source_file, "w") as out:
+        out.write(source)
+    command = [cxx] + flags + ["-c", source_file, "-o", object_file]
+    if clang:
+        command.append("-ftime-trace")
+
+    start = time.monotonic()
+    process = subprocess.Popen(command, stderr=subprocess.PIPE, universal_newlines=True)
+    _, status, usage = os.wait4(process.pid, 0)
+    elapsed = time.monotonic() - start
+    errors = process.stderr.read()
+    process.stderr.close()
+    if status != 0:
+        sys.exit("compilation failed:\n" + errors)
+
+    # ru_maxrss is in kilobytes on Linux and in bytes on macOS
+    peak_mb = usage.ru_maxrss / (1024 * 1024 if sys.platform == "darwin" else 1024)
+    if clang:
+        instantiations = count_instantiations(os.path.join(workdir, "pipeline.json"))
+    else:
+        instantiations = count_symbols(object_file)
+    return elapsed, peak_mb, instantiations
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "g++"))
+    parser.add_argument("--flags", default="-std=c++14 -O0", help="compiler flags (default: %(default)s)")
+    parser.add_argument("--depths", default="1,2,4,8,16,32")
+    parser.add_argument("--pipelines", default=",".join(PIPELINES))
+    parser.add_argument("--repeat", type=int, default=3, help="compilations per data point, the fastest is reported")
+    args = parser.parse_args()
+
+    repo = os.path.dirname(os.path.abspath(__file__))
+    flags = args.flags.split() + ["-I", repo]
+    clang = is_clang(args.cxx)
+    depths = [int(depth) for depth in args.depths.split(",")]
+
+    print("{:<8} {:>6} {:>10} {:>10} {:>16}".format(
+        "pipeline", "depth", "time [s]", "peak [MB]", "instantiations" if clang else "symbols"))
+    with tempfile.TemporaryDirectory() as workdir:
+        for name in args.pipelines.split(","):
+            for depth in depths:
+                source = PIPELINES[name](depth)
+                runs = [compile_once(args.cxx, flags, source, workdir, clang) for _ in range(args.repeat)]
+                elapsed = min(run[0] for run in runs)
+                peak_mb = max(run[1] for run in runs)
+                print("{:<8} {:>6} {:>10.2f} {:>10.1f} {:>16}".format(name, depth, elapsed, peak_mb, runs[0][2]))
+                sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
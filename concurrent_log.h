@@ -0,0 +1,268 @@
+#ifndef CONCURRENT_LOG_H
+#define CONCURRENT_LOG_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A Writer log for computations that run on many threads. With
+// W = concurrent_log, telling an entry appends it to a buffer of the calling
+// thread, which only that thread writes to, so it takes no lock and doesn't
+// contend with other threads:
+//
+//     log_collector collector;
+//     auto step = [&collector] (int x) { return writer(x + 1, log_to(collector, "step")); };
+//     // on worker thread i
+//     partial[i] = monad::iterateM(1000, step, writer(0, concurrent_log{}));
+//     // after joining the workers
+//     auto res = runWriter(monad::liftM2<Writer>(std::plus<>{})(partial[0], partial[1]));
+//
+// The log carried through >>= only records which ranges of which buffers
+// belong to it, in the order of the computation; combining logs with + just
+// concatenates these ranges. runWriter (at a point where the writing threads
+// have been joined) merges them into a vector of log_records numbered in
+// that order, so the result doesn't depend on how the threads were
+// scheduled. The buffers live as long as their collector.
+
+struct log_record {
+    // position in the merged log
+    std::size_t sequence;
+    // index of the thread that told the entry, in the order in which the
+    // threads first wrote to the collector
+    std::size_t thread;
+    std::string entry;
+};
+
+// Entries told by one thread. Entries are stored in chunks that never move,
+// the first holding firstChunkSize entries and every further one twice as
+// many as the one before, so other threads can read the entries below
+// size() while the owner appends.
+class thread_log_buffer {
+public:
+    explicit thread_log_buffer(std::size_t thread)
+        : _thread{thread}
+        , _size{0} {
+        for (auto& chunk : _chunks) {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    thread_log_buffer(const thread_log_buffer&) = delete;
+    thread_log_buffer& operator=(const thread_log_buffer&) = delete;
+
+    ~thread_log_buffer() {
+        for (auto& chunk : _chunks) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    // only called by the owning thread, returns the index of the entry
+    std::size_t append(std::string entry) {
+        const std::size_t index = _size.load(std::memory_order_relaxed);
+        const auto pos = locate(index);
+        std::string* chunk = _chunks[pos.first].load(std::memory_order_relaxed);
+        if (!chunk) {
+            chunk = new std::string[firstChunkSize << pos.first];
+            _chunks[pos.first].store(chunk, std::memory_order_release);
+        }
+        chunk[pos.second] = std::move(entry);
+        _size.store(index + 1, std::memory_order_release);
+        return index;
+    }
+
+    std::size_t size() const {
+        return _size.load(std::memory_order_acquire);
+    }
+
+    // index has to be below size()
+    const std::string& operator[](std::size_t index) const {
+        const auto pos = locate(index);
+        return _chunks[pos.first].load(std::memory_order_acquire)[pos.second];
+    }
+
+    std::size_t thread() const {
+        return _thread;
+    }
+
+private:
+    static constexpr std::size_t firstChunkSize = 256;
+    static constexpr std::size_t maxChunks = 48;
+
+    // chunk and offset of index
+    static std::pair<std::size_t, std::size_t> locate(std::size_t index) {
+        const std::size_t block = index / firstChunkSize + 1;
+        std::size_t chunk = 0;
+        while ((block >> (chunk + 1)) != 0) {
+            chunk++;
+        }
+        if (chunk >= maxChunks) {
+            throw std::length_error("thread_log_buffer is full");
+        }
+        return {chunk, index - firstChunkSize * ((std::size_t{1} << chunk) - 1)};
+    }
+
+    std::size_t _thread;
+    std::atomic<std::size_t> _size;
+    std::atomic<std::string*> _chunks[maxChunks];
+};
+
+// owns the buffers of all threads that log to it
+class log_collector {
+public:
+    log_collector()
+        : _id{nextId()} {
+    }
+
+    log_collector(const log_collector&) = delete;
+    log_collector& operator=(const log_collector&) = delete;
+
+    // the buffer of the calling thread. Each thread remembers the last
+    // collector it logged to, the lock is only taken when a thread switches
+    // to another collector.
+    thread_log_buffer& local() {
+        local_cache& cache = localCache();
+        if (cache.collector == _id) {
+            return *cache.buffer;
+        }
+        thread_log_buffer* buffer = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _byThread.find(cache.thread);
+            if (it != _byThread.end()) {
+                buffer = it->second;
+            } else {
+                _buffers.push_back(std::make_unique<thread_log_buffer>(_buffers.size()));
+                buffer = _buffers.back().get();
+                _byThread.emplace(cache.thread, buffer);
+            }
+        }
+        cache.collector = _id;
+        cache.buffer = buffer;
+        return *buffer;
+    }
+
+    std::size_t threads() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _buffers.size();
+    }
+
+private:
+    // the collector a thread logged to last, so a thread logging to many
+    // collectors in turn, e.g. one per request, keeps nothing of the others
+    struct local_cache {
+        std::uint64_t thread = nextId();
+        std::uint64_t collector = 0;
+        thread_log_buffer* buffer = nullptr;
+    };
+
+    // ids of collectors and threads instead of addresses and
+    // std::thread::id, which may be reused by a later one
+    static std::uint64_t nextId() {
+        static std::atomic<std::uint64_t> id{0};
+        return ++id;
+    }
+
+    static local_cache& localCache() {
+        static thread_local local_cache cache;
+        return cache;
+    }
+
+    std::uint64_t _id;
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<thread_log_buffer>> _buffers;
+    // the buffer of each thread by the id in its local_cache
+    std::unordered_map<std::uint64_t, thread_log_buffer*> _byThread;
+};
+
+// the log of a Writer whose entries live in the buffers of a log_collector
+class concurrent_log {
+public:
+    concurrent_log()
+        : _first{nullptr, 0, 0} {
+    }
+
+    concurrent_log(const thread_log_buffer& buffer, std::size_t begin, std::size_t end)
+        : _first{&buffer, begin, end} {
+    }
+
+    std::size_t entries() const {
+        std::size_t count = _first.end - _first.begin;
+        for (const auto& seg : _rest) {
+            count += seg.end - seg.begin;
+        }
+        return count;
+    }
+
+    // adjacent ranges of the same buffer are joined, so the log of a
+    // computation on a single thread stays one range
+    friend concurrent_log operator+(concurrent_log l1, const concurrent_log& l2) {
+        l1.append(l2._first);
+        for (const auto& seg : l2._rest) {
+            l1.append(seg);
+        }
+        return l1;
+    }
+
+    friend std::vector<log_record> materialize(const concurrent_log& log) {
+        std::vector<log_record> returnVec{};
+        returnVec.reserve(log.entries());
+        log.forEachSegment([&returnVec] (const segment& seg) {
+            for (std::size_t i = seg.begin; i < seg.end; i++) {
+                returnVec.push_back(log_record{returnVec.size(), seg.buffer->thread(), (*seg.buffer)[i]});
+            }
+        });
+        return returnVec;
+    }
+
+    friend std::vector<log_record> materialize(concurrent_log&& log) {
+        return materialize(static_cast<const concurrent_log&>(log));
+    }
+
+private:
+    struct segment {
+        const thread_log_buffer* buffer;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    void append(const segment& seg) {
+        if (seg.begin == seg.end) {
+            return;
+        }
+        segment& last = _rest.empty() ? _first : _rest.back();
+        if (last.begin == last.end) {
+            last = seg;
+        } else if (last.buffer == seg.buffer && last.end == seg.begin) {
+            last.end = seg.end;
+        } else {
+            _rest.push_back(seg);
+        }
+    }
+
+    template <typename funcType>
+    void forEachSegment(funcType&& f) const {
+        f(_first);
+        for (const auto& seg : _rest) {
+            f(seg);
+        }
+    }
+
+    segment _first;
+    std::vector<segment> _rest;
+};
+
+// appends entry to the buffer of the calling thread and returns the log
+// consisting of it
+inline concurrent_log log_to(log_collector& collector, std::string entry) {
+    thread_log_buffer& buffer = collector.local();
+    const std::size_t index = buffer.append(std::move(entry));
+    return concurrent_log{buffer, index, index + 1};
+}
+
+#endif
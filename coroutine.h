@@ -0,0 +1,393 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+// do-notation for optional, Writer and Task with C++20 coroutines: a function
+// returning do_block<M> may co_await values of the monad M and co_return the
+// plain result, e.g.
+//
+//     do_block<optional<int>> sumOfHalves(int a, int b) {
+//         int x = co_await half(a);
+//         int y = co_await half(b);
+//         co_return x + y;
+//     }
+//     optional<int> res = sumOfHalves(4, 6);
+//
+// which is the same computation as half(a) >>= [=] (int x) { return half(b)
+// >>= ... }, but without a closure per step. A do_block runs when it is
+// converted to M (or run() is called).
+//
+// The header is empty unless the compiler supports coroutines. The list monad
+// is not supported: its >>= resumes the continuation once per element, while
+// a coroutine frame can only be resumed from one suspension point once.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "optional.h"
+#include "task.h"
+#include "writer.h"
+
+template <typename>
+class do_block;
+
+namespace detail {
+    // Recycles coroutine frames. Freed frames are kept in per-thread free
+    // lists, one per size class, so the frames of a do_block that is run
+    // over and over don't go through the global allocator. Frames of blocks
+    // that are consumed right away may be elided by the compiler altogether.
+    class frame_arena {
+    public:
+        frame_arena() = default;
+        frame_arena(const frame_arena&) = delete;
+        frame_arena& operator=(const frame_arena&) = delete;
+
+        ~frame_arena() {
+            for (auto& list : _free) {
+                while (list.head) {
+                    ::operator delete(std::exchange(list.head, list.head->next));
+                }
+            }
+        }
+
+        void* allocate(std::size_t size) {
+            const std::size_t sizeClass = (size + granularity - 1) / granularity;
+            if (sizeClass < sizeClasses && _free[sizeClass].head) {
+                auto& list = _free[sizeClass];
+                --list.count;
+                return std::exchange(list.head, list.head->next);
+            }
+            return ::operator new(sizeClass * granularity);
+        }
+
+        void deallocate(void* ptr, std::size_t size) noexcept {
+            const std::size_t sizeClass = (size + granularity - 1) / granularity;
+            if (sizeClass < sizeClasses && _free[sizeClass].count < maxCached) {
+                auto& list = _free[sizeClass];
+                list.head = ::new (ptr) free_block{list.head};
+                ++list.count;
+            } else {
+                ::operator delete(ptr);
+            }
+        }
+
+        static frame_arena& local() {
+            static thread_local frame_arena arena;
+            return arena;
+        }
+
+    private:
+        static constexpr std::size_t granularity = 64;
+        static constexpr std::size_t sizeClasses = 64;
+        static constexpr std::size_t maxCached = 256;
+
+        struct free_block {
+            free_block* next;
+        };
+
+        struct free_list {
+            free_block* head = nullptr;
+            std::size_t count = 0;
+        };
+
+        free_list _free[sizeClasses];
+    };
+
+    // base of the promise types, allocates their frames from the arena
+    struct arena_promise {
+        static void* operator new(std::size_t size) {
+            return frame_arena::local().allocate(size);
+        }
+
+        static void operator delete(void* ptr, std::size_t size) noexcept {
+            frame_arena::local().deallocate(ptr, size);
+        }
+    };
+
+    // owns a coroutine frame and destroys it unless it was released
+    template <typename Promise>
+    class unique_frame {
+    public:
+        explicit unique_frame(std::coroutine_handle<Promise> handle)
+            : _handle{handle} {
+        }
+
+        unique_frame(unique_frame&& other) noexcept
+            : _handle{std::exchange(other._handle, nullptr)} {
+        }
+
+        unique_frame& operator=(unique_frame&&) = delete;
+
+        ~unique_frame() {
+            if (_handle) {
+                _handle.destroy();
+            }
+        }
+
+        std::coroutine_handle<Promise> get() const {
+            return _handle;
+        }
+
+        std::coroutine_handle<Promise> release() {
+            return std::exchange(_handle, nullptr);
+        }
+
+    private:
+        std::coroutine_handle<Promise> _handle;
+    };
+
+    // Awaiting an empty optional suspends the block for good, run() then
+    // finds it unfinished and returns nothing. Source is a reference for
+    // lvalues and a value for temporaries, which are moved into the block.
+    template <typename Source>
+    struct optional_awaiter {
+        bool await_ready() const noexcept {
+            return !_x.is_nothing();
+        }
+
+        void await_suspend(std::coroutine_handle<>) const noexcept {
+        }
+
+        decltype(auto) await_resume() {
+            return *std::forward<Source>(_x);
+        }
+
+        Source _x;
+    };
+
+    // hands out a value that is already known
+    template <typename T>
+    struct value_awaiter {
+        bool await_ready() const noexcept {
+            return true;
+        }
+
+        void await_suspend(std::coroutine_handle<>) const noexcept {
+        }
+
+        T&& await_resume() {
+            return *std::move(_val);
+        }
+
+        optional<T> _val;
+    };
+
+    // resumes the block on the pool once the task finished
+    template <typename T>
+    struct task_awaiter {
+        bool await_ready() const noexcept {
+            return _task.is_ready();
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) const {
+            _task.on_ready([handle] { handle.resume(); });
+        }
+
+        const T& await_resume() const {
+            return _task.get();
+        }
+
+        Task<T> _task;
+    };
+} // namespace detail
+
+// optional: the block stops at the first empty optional it awaits
+template <typename T>
+class do_block<optional<T>> {
+public:
+    struct promise_type : detail::arena_promise {
+        do_block get_return_object() {
+            return do_block{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        void return_value(T val) {
+            _result.emplace(std::move(val));
+        }
+
+        void unhandled_exception() {
+            throw;
+        }
+
+        template <typename Source, typename = std::enable_if_t<is_container<optional, std::decay_t<Source>>{}()>>
+        auto await_transform(Source&& x) {
+            return detail::optional_awaiter<Source>{std::forward<Source>(x)};
+        }
+
+        template <typename U>
+        auto await_transform(do_block<optional<U>>&& block) {
+            return detail::optional_awaiter<optional<U>>{std::move(block).run()};
+        }
+
+        optional<T> _result;
+    };
+
+    optional<T> run() && {
+        auto handle = _frame.get();
+        handle.resume();
+        return handle.done() ? std::move(handle.promise()._result) : optional<T>{};
+    }
+
+    operator optional<T>() && {
+        return std::move(*this).run();
+    }
+
+private:
+    explicit do_block(std::coroutine_handle<promise_type> handle)
+        : _frame{handle} {
+    }
+
+    detail::unique_frame<promise_type> _frame;
+};
+
+// Writer: the logs of the awaited writers are concatenated in order
+template <typename T, typename W>
+class do_block<monad::Writer::Writer<T, W>> {
+public:
+    struct promise_type : detail::arena_promise {
+        do_block get_return_object() {
+            return do_block{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        void return_value(T val) {
+            _result.emplace(std::move(_log) >>= [&val] { return monad::Writer::Writer<T, W>{std::move(val)}; });
+        }
+
+        void unhandled_exception() {
+            throw;
+        }
+
+        template <typename U>
+        auto await_transform(do_block<monad::Writer::Writer<U, W>>&& block) {
+            return await_transform(std::move(block).run());
+        }
+
+        template <typename Source, typename = std::enable_if_t<std::is_same<monad::Writer::traits::writer_log_t<std::decay_t<Source>>, W>{}()>>
+        auto await_transform(Source&& x) {
+            return await(std::is_void<monad::Writer::traits::writer_base_t<std::decay_t<Source>>>{}, std::forward<Source>(x));
+        }
+
+        optional<monad::Writer::Writer<T, W>> _result;
+
+    private:
+        // the log written so far
+        monad::Writer::Writer<void, W> _log;
+
+        template <typename Source>
+        std::suspend_never await(std::true_type, Source&& x) {
+            _log = std::move(_log) >>= [&x] { return std::forward<Source>(x); };
+            return {};
+        }
+
+        template <typename Source>
+        auto await(std::false_type, Source&& x) {
+            detail::value_awaiter<monad::Writer::traits::writer_base_t<std::decay_t<Source>>> awaiter{};
+            _log = std::move(_log) >>= [&x, &awaiter] {
+                return std::forward<Source>(x) >>= [&awaiter] (auto&& val) {
+                    awaiter._val.emplace(std::forward<decltype(val)>(val));
+                    return monad::Writer::Writer<void, W>{};
+                };
+            };
+            return awaiter;
+        }
+    };
+
+    monad::Writer::Writer<T, W> run() && {
+        auto handle = _frame.get();
+        handle.resume();
+        return std::move(*handle.promise()._result);
+    }
+
+    operator monad::Writer::Writer<T, W>() && {
+        return std::move(*this).run();
+    }
+
+private:
+    explicit do_block(std::coroutine_handle<promise_type> handle)
+        : _frame{handle} {
+    }
+
+    detail::unique_frame<promise_type> _frame;
+};
+
+// Task: the block runs on the pool and is suspended, without blocking a
+// thread, while an awaited task is not finished yet
+template <typename T>
+class do_block<Task<T>> {
+public:
+    struct promise_type : detail::arena_promise {
+        do_block get_return_object() {
+            return do_block{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        // the frame destroys itself once the block finished
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_value(T val) {
+            _state->set_value(std::move(val));
+        }
+
+        void unhandled_exception() {
+            _state->set_error(std::current_exception());
+        }
+
+        template <typename U>
+        auto await_transform(Task<U> task) {
+            return detail::task_awaiter<U>{std::move(task)};
+        }
+
+        template <typename U>
+        auto await_transform(do_block<Task<U>>&& block) {
+            return detail::task_awaiter<U>{std::move(block).run()};
+        }
+
+        std::shared_ptr<detail::task_state<T>> _state;
+    };
+
+    // starts the block on pool and returns the task of its result
+    Task<T> run(thread_pool& pool = thread_pool::default_pool()) && {
+        auto handle = _frame.release();
+        auto state = std::make_shared<detail::task_state<T>>(pool);
+        handle.promise()._state = state;
+        pool.submit([handle] { handle.resume(); });
+        return Task<T>{state};
+    }
+
+    operator Task<T>() && {
+        return std::move(*this).run();
+    }
+
+private:
+    explicit do_block(std::coroutine_handle<promise_type> handle)
+        : _frame{handle} {
+    }
+
+    detail::unique_frame<promise_type> _frame;
+};
+
+#endif
+#endif
@@ -14,8 +14,16 @@ using void_t = void;
 template <typename, typename = void>
 struct is_callable : std::false_type {};
 
+// Plain callables are probed with the call expression itself, which is a lot
+// cheaper to instantiate than result_of and its INVOKE overload set. Only
+// pointers to members still go through result_of.
 template <typename F, typename... Args>
-struct is_callable<F(Args...), void_t<std::result_of_t<F(Args...)>>> : std::true_type {};
+struct is_callable<F(Args...), std::enable_if_t<!std::is_member_pointer<std::decay_t<F>>::value,
+    void_t<decltype(std::declval<F>()(std::declval<Args>()...))>>> : std::true_type {};
+
+template <typename F, typename... Args>
+struct is_callable<F(Args...), std::enable_if_t<std::is_member_pointer<std::decay_t<F>>::value,
+    void_t<std::result_of_t<F(Args...)>>>> : std::true_type {};
 
 // constexpr bool convenience wrappers
 template <typename F, typename...Args>
@@ -51,7 +59,7 @@ template <class T>
 constexpr bool is_reference_wrapper_v = is_reference_wrapper<T>::value;
 
 template <class Base, class T, class Derived, class... Args>
-auto INVOKE(T Base::*pmf, Derived&& ref, Args&&... args)
+constexpr auto INVOKE(T Base::*pmf, Derived&& ref, Args&&... args)
     noexcept(noexcept((std::forward<Derived>(ref).*pmf)(std::forward<Args>(args)...)))
  -> std::enable_if_t<is_function_v<T> &&
                      is_base_of_v<Base, std::decay_t<Derived>>,
@@ -61,7 +69,7 @@ auto INVOKE(T Base::*pmf, Derived&& ref, Args&&... args)
 }
 
 template <class Base, class T, class RefWrap, class... Args>
-auto INVOKE(T Base::*pmf, RefWrap&& ref, Args&&... args)
+constexpr auto INVOKE(T Base::*pmf, RefWrap&& ref, Args&&... args)
     noexcept(noexcept((ref.get().*pmf)(std::forward<Args>(args)...)))
  -> std::enable_if_t<is_function_v<T> &&
                      is_reference_wrapper_v<std::decay_t<RefWrap>>,
@@ -72,7 +80,7 @@ auto INVOKE(T Base::*pmf, RefWrap&& ref, Args&&... args)
 }
 
 template <class Base, class T, class Pointer, class... Args>
-auto INVOKE(T Base::*pmf, Pointer&& ptr, Args&&... args)
+constexpr auto INVOKE(T Base::*pmf, Pointer&& ptr, Args&&... args)
     noexcept(noexcept(((*std::forward<Pointer>(ptr)).*pmf)(std::forward<Args>(args)...)))
  -> std::enable_if_t<is_function_v<T> &&
                      !is_reference_wrapper_v<std::decay_t<Pointer>> &&
@@ -83,7 +91,7 @@ auto INVOKE(T Base::*pmf, Pointer&& ptr, Args&&... args)
 }
 
 template <class Base, class T, class Derived>
-auto INVOKE(T Base::*pmd, Derived&& ref)
+constexpr auto INVOKE(T Base::*pmd, Derived&& ref)
     noexcept(noexcept(std::forward<Derived>(ref).*pmd))
  -> std::enable_if_t<!is_function_v<T> &&
                      is_base_of_v<Base, std::decay_t<Derived>>,
@@ -93,7 +101,7 @@ auto INVOKE(T Base::*pmd, Derived&& ref)
 }
 
 template <class Base, class T, class RefWrap>
-auto INVOKE(T Base::*pmd, RefWrap&& ref)
+constexpr auto INVOKE(T Base::*pmd, RefWrap&& ref)
     noexcept(noexcept(ref.get().*pmd))
  -> std::enable_if_t<!is_function_v<T> &&
                      is_reference_wrapper_v<std::decay_t<RefWrap>>,
@@ -103,7 +111,7 @@ auto INVOKE(T Base::*pmd, RefWrap&& ref)
 }
 
 template <class Base, class T, class Pointer>
-auto INVOKE(T Base::*pmd, Pointer&& ptr)
+constexpr auto INVOKE(T Base::*pmd, Pointer&& ptr)
     noexcept(noexcept((*std::forward<Pointer>(ptr)).*pmd))
  -> std::enable_if_t<!is_function_v<T> &&
                      !is_reference_wrapper_v<std::decay_t<Pointer>> &&
@@ -114,7 +122,7 @@ auto INVOKE(T Base::*pmd, Pointer&& ptr)
 }
 
 template <class F, class... Args>
-auto INVOKE(F&& f, Args&&... args)
+constexpr auto INVOKE(F&& f, Args&&... args)
     noexcept(noexcept(std::forward<F>(f)(std::forward<Args>(args)...)))
  -> std::enable_if_t<!is_member_pointer_v<std::decay_t<F>>,
     decltype(std::forward<F>(f)(std::forward<Args>(args)...))>
@@ -124,7 +132,7 @@ auto INVOKE(F&& f, Args&&... args)
 } // namespace detail
 
 template< class F, class... ArgTypes >
-auto invoke(F&& f, ArgTypes&&... args)
+constexpr auto invoke(F&& f, ArgTypes&&... args)
     // exception specification for QoI
     noexcept(noexcept(detail::INVOKE(std::forward<F>(f), std::forward<ArgTypes>(args)...)))
  -> decltype(detail::INVOKE(std::forward<F>(f), std::forward<ArgTypes>(args)...))
@@ -5,50 +5,168 @@
 #include <functional>
 #include <type_traits>
 #include "cpp17.h"
+#include "instrument.h"
 
 
 namespace detail {
 
+    // number of parameters of callables with exactly one, non-template call
+    // signature (function pointers, non-generic lambdas, ...) and -1 for all
+    // others (generic lambdas, functors with overloaded or templated call
+    // operators), whose saturation has to be probed with is_callable.
+    template <typename F, typename = void>
+    struct callable_arity : std::integral_constant<int, -1> {};
+
+    template <typename R, typename... Args>
+    struct callable_arity<R(*)(Args...)> : std::integral_constant<int, sizeof...(Args)> {};
+
+    template <typename>
+    struct member_fn_arity : std::integral_constant<int, -1> {};
+
+    template <typename R, typename C, typename... Args>
+    struct member_fn_arity<R (C::*)(Args...)> : std::integral_constant<int, sizeof...(Args)> {};
+
+    template <typename R, typename C, typename... Args>
+    struct member_fn_arity<R (C::*)(Args...) const> : std::integral_constant<int, sizeof...(Args)> {};
+
+    template <typename F>
+    struct callable_arity<F, void_t<decltype(&F::operator())>> : member_fn_arity<decltype(&F::operator())> {};
+
+    // arguments captured as std::reference_wrapper<T> are passed on as T&
+    template <typename T>
+    struct unwrap_reference {
+        using type = T;
+    };
+
+    template <typename T>
+    struct unwrap_reference<std::reference_wrapper<T>> {
+        using type = T&;
+    };
+
+    template <typename T>
+    constexpr T&& unwrap(T&& val, std::false_type) {
+        return std::forward<T>(val);
+    }
+
+    template <typename T>
+    constexpr decltype(auto) unwrap(T&& val, std::true_type) {
+        return val.get();
+    }
+
+    template <typename T>
+    constexpr decltype(auto) unwrap(T&& val) {
+        return unwrap(std::forward<T>(val), is_reference_wrapper<std::decay_t<T>>{});
+    }
+
+    // selects the constructor of curried_fn that takes the function and the
+    // values of all captured arguments
+    struct capture_args_t {};
+
+    // Flat storage for the captured arguments. std::tuple is implemented
+    // recursively, so every curried_fn that captures one more argument would
+    // instantiate a whole new chain of base classes. Here the leaves are shared
+    // by all argument lists with a common prefix, which keeps the number of
+    // instantiated classes linear in the arity of the curried function.
+    template <std::size_t I, typename T>
+    struct captured_arg {
+        template <typename U>
+        constexpr explicit captured_arg(U&& val)
+            : _val(std::forward<U>(val)) {
+        }
+
+        T _val;
+    };
+
+    template <typename, typename...>
+    struct captured_args;
+
+    template <std::size_t... I, typename... T>
+    struct captured_args<std::index_sequence<I...>, T...> : captured_arg<I, T>... {
+        template <typename... Args>
+        constexpr explicit captured_args(capture_args_t, Args&&... args)
+            : captured_arg<I, T>(std::forward<Args>(args))... {
+        }
+    };
+
+    template <std::size_t I, typename T>
+    constexpr T& get_captured(captured_arg<I, T>& arg) {
+        return arg._val;
+    }
+
+    template <std::size_t I, typename T>
+    constexpr const T& get_captured(const captured_arg<I, T>& arg) {
+        return arg._val;
+    }
+
+    template <std::size_t I, typename T>
+    constexpr T&& get_captured(captured_arg<I, T>&& arg) {
+        return std::move(arg._val);
+    }
+
     template <typename F, typename... CapturedArgs>
     class curried_fn {
     public:
 
-        curried_fn(const F& f)
-            : _f{f}
-            , _capturedArgs{std::make_tuple()} {
+        constexpr curried_fn(F f)
+            : _f{std::move(f)}
+            , _capturedArgs{capture_args_t{}} {
         }
 
-        curried_fn(const F&& f)
-            : _f{std::move(f)} {
+        template <typename G, typename... Args>
+        constexpr curried_fn(capture_args_t, G&& f, Args&&... args)
+            : _f(std::forward<G>(f))
+            , _capturedArgs(capture_args_t{}, std::forward<Args>(args)...) {
         }
 
-        curried_fn(const F& f, const std::tuple<CapturedArgs...>& capturedArgs)
-            : _f{f}
-            , _capturedArgs{capturedArgs} {
+        // Calls f once all of its arguments are known and otherwise returns a
+        // curried_fn that captures args as well. Arguments are captured by
+        // value (rvalues are moved), wrap them in std::ref to capture them by
+        // reference.
+        template <typename... Args>
+        constexpr auto operator()(Args&&... args) const& {
+            return call(is_saturated<const F&, const typename unwrap_reference<CapturedArgs>::type&..., Args&&...>{},
+                        *this, std::index_sequence_for<CapturedArgs...>{}, std::forward<Args>(args)...);
         }
 
-        template <typename Arg, typename... Args>
-        auto operator()(Arg&& arg, Args&&... args) const  -> std::enable_if_t<!is_callable<F(CapturedArgs..., Arg, Args...)>::value, curried_fn<F, CapturedArgs..., std::decay_t<Arg>, std::decay_t<Args>...>> {
-            return curried_fn<F, CapturedArgs..., std::decay_t<Arg>, std::decay_t<Args>...>(_f, std::tuple_cat(_capturedArgs, std::make_tuple(arg, args...)));
+        // like above but calls f as a non-const lvalue, e.g. a mutable lambda
+        template <typename... Args>
+        constexpr auto operator()(Args&&... args) & {
+            return call(is_saturated<F&, typename unwrap_reference<CapturedArgs>::type&..., Args&&...>{},
+                        *this, std::index_sequence_for<CapturedArgs...>{}, std::forward<Args>(args)...);
         }
 
+        // like above but moves f and the captured arguments
         template <typename... Args>
-        auto operator()(Args&&... args) const -> std::enable_if_t<is_callable<F(CapturedArgs..., Args...)>::value, std::remove_reference_t<std::result_of_t<F(CapturedArgs..., Args...)>>> {
-           return apply(_f, _capturedArgs, std::make_tuple(std::forward<Args>(args)...));
+        constexpr decltype(auto) operator()(Args&&... args) && {
+            return call(is_saturated<F&&, typename unwrap_reference<CapturedArgs>::type&&..., Args&&...>{},
+                        std::move(*this), std::index_sequence_for<CapturedArgs...>{}, std::forward<Args>(args)...);
         }
 
-        template <typename Arg, typename... Args>
-        auto operator()(Arg&& arg, Args&&... args) -> std::enable_if_t<!is_callable<F(CapturedArgs..., Arg, Args...)>::value, curried_fn<std::remove_const_t<F>, CapturedArgs..., std::decay_t<Arg>, std::decay_t<Args>...>> {
-            return curried_fn<std::remove_const_t<F>, CapturedArgs..., std::decay_t<Arg>, std::decay_t<Args>...>(std::move(_f), std::tuple_cat(std::move(_capturedArgs), std::make_tuple(arg, args...)));
+    private:
+        template <typename, typename...>
+        friend class curried_fn;
+
+        // whether FuncRef can be called with CallArgs. Decided by the arity of
+        // F if it has a unique one, so is_callable only has to be instantiated
+        // for generic callables.
+        template <typename FuncRef, typename... CallArgs>
+        using is_saturated = typename std::conditional_t<(callable_arity<F>::value >= 0),
+            std::integral_constant<bool, (sizeof...(CallArgs) >= static_cast<std::size_t>(callable_arity<F>::value >= 0 ? callable_arity<F>::value : 0))>,
+            is_callable<FuncRef(CallArgs...)>>::type;
+
+        template <typename Self, std::size_t... I, typename... Args>
+        static constexpr decltype(auto) call(std::true_type, Self&& self, std::index_sequence<I...>, Args&&... args) {
+            return ::invoke(std::forward<Self>(self)._f, unwrap(get_captured<I>(std::forward<Self>(self)._capturedArgs))..., std::forward<Args>(args)...);
         }
 
-        template <typename... Args>
-        auto operator()(Args&&... args) -> std::enable_if_t<is_callable<F(CapturedArgs..., Args...)>::value, std::result_of_t<F(CapturedArgs..., Args...)>> {
-           return apply(std::move(_f), std::move(_capturedArgs), std::make_tuple(std::forward<Args>(args)...));
+        template <typename Self, std::size_t... I, typename... Args>
+        static constexpr auto call(std::false_type, Self&& self, std::index_sequence<I...>, Args&&... args) {
+            return curried_fn<F, CapturedArgs..., std::decay_t<Args>...>(capture_args_t{}, std::forward<Self>(self)._f,
+                get_captured<I>(std::forward<Self>(self)._capturedArgs)..., std::forward<Args>(args)...);
         }
-    private:
+
         F _f;
-        std::tuple<CapturedArgs...> _capturedArgs;
+        captured_args<std::index_sequence_for<CapturedArgs...>, CapturedArgs...> _capturedArgs;
     };
 
 } // namespace detail
@@ -61,19 +179,25 @@ namespace traits {
     struct is_curried_fn<detail::curried_fn<F, Args...>> : std::true_type {};
 
     template <typename T>
-    constexpr bool is_curried_fn_v = is_curried_fn<std::remove_reference_t<T>>::value;
+    constexpr bool is_curried_fn_v = is_curried_fn<std::decay_t<T>>::value;
 } // namespace traits
 
 template <typename F>
-auto curry(F&& f) -> std::enable_if_t<!traits::is_curried_fn_v<F>, detail::curried_fn<std::remove_const_t<std::remove_reference_t<F>>>> {
-    detail::curried_fn<std::remove_const_t<std::remove_reference_t<F>>> retVal(std::forward<F>(f));
+constexpr auto curry(F&& f) -> std::enable_if_t<!traits::is_curried_fn_v<F>, detail::curried_fn<std::decay_t<F>>> {
+    MONAD_COUNT(curries);
+    detail::curried_fn<std::decay_t<F>> retVal(std::forward<F>(f));
     return retVal;
 }
 
 template <typename F, typename... Args>
-detail::curried_fn<F, Args...> curry(const detail::curried_fn<F, Args...>& curriedFn) {
+constexpr detail::curried_fn<F, Args...> curry(const detail::curried_fn<F, Args...>& curriedFn) {
     return curriedFn;
 }
 
+template <typename F, typename... Args>
+constexpr detail::curried_fn<F, Args...> curry(detail::curried_fn<F, Args...>&& curriedFn) {
+    return std::move(curriedFn);
+}
+
 
 #endif
@@ -1,8 +1,11 @@
+#include "fixed_seq.h"
 #include "list.h"
+#include "vector.h"
 #include "monad.h"
 #include "monoid.h"
 #include "optional.h"
 #include "writer.h"
+#include <functional>
 #include <iostream>
 #include <string>
 
@@ -17,11 +20,60 @@ struct square {
 template <>
 struct square<void> {
     template <typename T>
-    T operator()(T&& x) const {
+    constexpr std::decay_t<T> operator()(T&& x) const {
         return x * std::forward<decltype(x)>(x);
     }
 };
 
+// curry, optional, fixed_seq and the monad combinators can be evaluated at
+// compile time as long as the functions involved are constexpr (and the
+// counters of instrument.h are compiled out)
+#ifndef MONAD_INSTRUMENT
+namespace compile_time {
+    struct add {
+        constexpr int operator()(int a, int b) const {
+            return a + b;
+        }
+    };
+
+    constexpr int add3(int a, int b, int c) {
+        return a + b + c;
+    }
+
+    constexpr optional<int> half(int x) {
+        return x % 2 == 0 ? optional<int>{x / 2} : optional<int>{};
+    }
+
+    constexpr fixed_seq<int> twice(int x) {
+        return fixed_seq<int>{x, x};
+    }
+
+    // just fits its elements, binding it to more than one element needs a
+    // result with a larger capacity
+    constexpr fixed_seq<int, seq_capacity<2>> twiceTight(int x) {
+        return fixed_seq<int, seq_capacity<2>>{x, x};
+    }
+
+    static_assert(curry(add3)(1)(2)(3) == 6, "curry");
+    static_assert(curry(add3)(1, 2)(3) == 6, "curry");
+    static_assert(*((optional<int>{8} >>= half) >>= half) == 2, "optional >>=");
+    static_assert(((optional<int>{6} >>= half) >>= half).is_nothing(), "optional >>=");
+    static_assert(*monad::pure<optional>(3) == 3, "pure");
+    static_assert(*monad::fmap(square<>{}, optional<int>{3}) == 9, "fmap");
+    static_assert(*monad::ap(monad::ap(monad::pure<optional>(add{}), optional<int>{1}), optional<int>{2}) == 3, "ap");
+    static_assert(monad::liftM<optional>(square<>{})(optional<int>{4}).from_optional() == 16, "liftM");
+    static_assert(monad::liftM2<optional>(add{})(optional<int>{41}, optional<int>{1}).from_optional() == 42, "liftM2");
+    static_assert(monad::liftM2<optional>(add{})(optional<int>{41}, optional<int>{}).is_nothing(), "liftM2");
+
+    static_assert(monad::is_monad_v<fixed_seq>, "fixed_seq is a monad");
+    static_assert((fixed_seq<int>{1, 2} >>= twice) == fixed_seq<int>{1, 1, 2, 2}, "fixed_seq >>=");
+    static_assert(fixed_seq<int>{1, 2}.bind<seq_capacity<16>>(twiceTight) == fixed_seq<int>{1, 1, 2, 2}, "fixed_seq bind");
+    static_assert(monad::fmap(square<>{}, fixed_seq<int>{1, 2, 3}) == fixed_seq<int>{1, 4, 9}, "fixed_seq fmap");
+    constexpr auto table = monad::liftM2<fixed_seq>(add{})(fixed_seq<int>{1, 2, 3}, fixed_seq<int>{10, 20});
+    static_assert(table.size() == 6 && table[0] == 11 && table[5] == 23, "fixed_seq liftM2");
+} // namespace compile_time
+#endif
+
 int main() {
     /*************************************
      *      Exercise 1                   *
@@ -103,6 +155,14 @@ int main() {
                                             std::list<int>{3, 4, 5}));
     std::cout << std::endl;
 
+    // std::vector has a monad instance as well (see vector.h), so the same
+    // lifted functions work on contiguous storage
+    auto sumVector = monad::liftM2<std::vector>(std::plus<>{});
+    std::cout << "Testing sumVector...\n";
+                 printList(sumVector(std::vector<int>{1, 2, 3},
+                                     std::vector<int>{10, 20}));
+    std::cout << std::endl;
+
     /*************************************
      *     Exercise 4                    *
      *************************************/
@@ -113,7 +173,7 @@ using namespace monad::Writer;
 using namespace std::literals;
 
    auto logNumber = [](auto x) {
-       return writer(x, pure<list>("Got number: " + to_string(x)));
+       return writer(x, pure<rope>("Got number: " + to_string(x)));
     };
 
    auto logAddition = [&logNumber] (auto x, auto y) {
@@ -123,12 +183,12 @@ using namespace std::literals;
    int result;
    list<string> log;
 
-   auto startComputation = tell(pure<list>("Starting computation..."s));
+   auto startComputation = tell(pure<rope>("Starting computation..."s));
 
    std::tie(result, log) = runWriter(
            (startComputation
        >>= [&logAddition] { return logAddition(3, 4); })
-       >>= [] (auto res) { return writer(res, pure<list>("Result is: " + to_string(res)));});
+       >>= [] (auto res) { return writer(res, pure<rope>("Result is: " + to_string(res)));});
 
    std::cout << "Result of logAddition(3, 4): " << result << std::endl;
    printList(log);
@@ -140,9 +200,10 @@ using namespace std::literals;
 
    // In writer.h there is an implementation of a Writer_l where l is an
    // arbitrty monoid (see monoid.h)
-   // The default is std::list<std::string>, i.e. StringListWriter used in
-   // Exercise 4. If one wants to use another monoid for logginig, one has to
-   // first declare a templated struct, e.g. for an Writer_int as follows:
+   // The default is rope<std::string> (see rope.h), i.e. the string log used
+   // in Exercise 4, which runWriter hands out as a std::list<std::string>.
+   // If one wants to use another monoid for logginig, one has to first
+   // declare a templated struct, e.g. for an Writer_int as follows:
    //
    // Make sure that the type you're using actually is a monoid, i.e. supports
    // default construction and operator+
@@ -154,14 +215,14 @@ using namespace std::literals;
    // with log being the zero element of the monoid one wishes to use.
 
 
+   // iterateM binds countOperation 42 times, moving the value and the log
+   // from one step to the next
    auto countOperation = [] (auto x) { return writer(x, 1); };
-   auto computation = writer("the answer to life, the universe and everything", 0);
-   for (int i = 0; i < 42; i++) {
-        computation = computation >>= countOperation;
-   }
+   auto computation = iterateM(42, countOperation, writer("the answer to life, the universe and everything", 0));
    auto res = runWriter(computation);
    std::cout << "Result of computation: " << get<0>(res) << std::endl;
    std::cout << "'log' of computation: " << get<1>(res) << std::endl;
+   std::cout << std::endl;
 }
 
 
@@ -0,0 +1,301 @@
+#ifndef EXPECTED_H
+#define EXPECTED_H
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include "applicative.h"
+#include "instrument.h"
+
+// Expected<T, E> holds either a value of type T or an error of type E, both
+// in the same storage. >>= passes the value on and carries an error through
+// to the end of the chain without calling the remaining steps, so failures
+// are reported without throwing and without allocating:
+//
+//     Expected<int> parse(const std::string& str);
+//     Expected<int> checked = parse(input) >>= [] (int x) -> Expected<int> {
+//         return x >= 0 ? Expected<int>{x} : make_unexpected(std::make_error_code(std::errc::result_out_of_range));
+//     };
+//
+// An error is created with make_unexpected(e), so T and E may be the same
+// type.
+
+template <typename E>
+struct unexpected {
+    E error;
+};
+
+template <typename E>
+unexpected<std::decay_t<E>> make_unexpected(E&& error) {
+    return unexpected<std::decay_t<E>>{std::forward<E>(error)};
+}
+
+namespace detail {
+    // Storage of Expected<T, E>, trivially copyable if T and E are, like
+    // optional_storage.
+    template <typename T, typename E, bool = std::is_trivially_copyable<T>::value && std::is_trivially_copyable<E>::value>
+    struct expected_storage {
+        template <typename... Args>
+        constexpr explicit expected_storage(std::true_type, Args&&... args)
+            : _val(std::forward<Args>(args)...)
+            , _hasValue{true} {
+        }
+
+        template <typename... Args>
+        constexpr explicit expected_storage(std::false_type, Args&&... args)
+            : _error(std::forward<Args>(args)...)
+            , _hasValue{false} {
+        }
+
+        union {
+            T _val;
+            E _error;
+        };
+        bool _hasValue;
+    };
+
+    template <typename T, typename E>
+    struct expected_storage<T, E, false> {
+        template <typename... Args>
+        explicit expected_storage(std::true_type, Args&&... args)
+            : _val(std::forward<Args>(args)...)
+            , _hasValue{true}
+            , _valueless{false} {
+        }
+
+        template <typename... Args>
+        explicit expected_storage(std::false_type, Args&&... args)
+            : _error(std::forward<Args>(args)...)
+            , _hasValue{false}
+            , _valueless{false} {
+        }
+
+        expected_storage(const expected_storage& other)
+            : _hasValue{other._hasValue}
+            , _valueless{false} {
+            construct(other);
+        }
+
+        expected_storage(expected_storage&& other) noexcept(std::is_nothrow_move_constructible<T>::value
+                                                         && std::is_nothrow_move_constructible<E>::value)
+            : _hasValue{other._hasValue}
+            , _valueless{false} {
+            construct(std::move(other));
+        }
+
+        // copies other first, so a throwing copy leaves this unchanged
+        expected_storage& operator=(const expected_storage& other) {
+            if (this != &other) {
+                *this = expected_storage(other);
+            }
+            return *this;
+        }
+
+        // assignment rebuilds the content so T and E don't need to be
+        // assignable. If that throws, this is left valueless: it holds
+        // nothing and may only be assigned to or destroyed.
+        expected_storage& operator=(expected_storage&& other) noexcept(std::is_nothrow_move_constructible<T>::value
+                                                                    && std::is_nothrow_move_constructible<E>::value) {
+            if (this != &other) {
+                destroy();
+                _valueless = true;
+                _hasValue = other._hasValue;
+                construct(std::move(other));
+                _valueless = false;
+            }
+            return *this;
+        }
+
+        ~expected_storage() {
+            destroy();
+        }
+
+        // constructs the content of other, _hasValue must already match it
+        template <typename Other>
+        void construct(Other&& other) {
+            if (_hasValue) {
+                ::new (static_cast<void*>(std::addressof(_val))) T(std::forward<Other>(other)._val);
+            } else {
+                ::new (static_cast<void*>(std::addressof(_error))) E(std::forward<Other>(other)._error);
+            }
+        }
+
+        void destroy() {
+            if (_valueless) {
+                return;
+            }
+            if (_hasValue) {
+                _val.~T();
+            } else {
+                _error.~E();
+            }
+        }
+
+        union {
+            T _val;
+            E _error;
+        };
+        bool _hasValue;
+        // set while the content is rebuilt, see operator=
+        bool _valueless;
+    };
+} // namespace detail
+
+template <typename T, typename E = std::error_code>
+class Expected : private detail::expected_storage<T, E> {
+    static_assert(!std::is_reference<T>::value && !std::is_reference<E>::value, "Expected of a reference type is not supported");
+
+public:
+    using value_type = T;
+    using error_type = E;
+
+    Expected(const T& val)
+        : detail::expected_storage<T, E>(std::true_type{}, val) {
+    }
+
+    Expected(T&& val)
+        : detail::expected_storage<T, E>(std::true_type{}, std::move(val)) {
+    }
+
+    template <typename G, typename = std::enable_if_t<std::is_constructible<E, const G&>::value>>
+    Expected(const unexpected<G>& error)
+        : detail::expected_storage<T, E>(std::false_type{}, error.error) {
+    }
+
+    template <typename G, typename = std::enable_if_t<std::is_constructible<E, G&&>::value>>
+    Expected(unexpected<G>&& error)
+        : detail::expected_storage<T, E>(std::false_type{}, std::move(error.error)) {
+    }
+
+    bool has_value() const {
+        return this->_hasValue;
+    }
+
+    explicit operator bool() const {
+        return has_value();
+    }
+
+    // an error ends every chain it is bound into, see monad::short_circuits
+    bool is_nothing() const {
+        return !has_value();
+    }
+
+    // unchecked access, the Expected must hold a value resp. an error
+    T& operator*() & {
+        return this->_val;
+    }
+
+    const T& operator*() const& {
+        return this->_val;
+    }
+
+    T&& operator*() && {
+        return std::move(this->_val);
+    }
+
+    T* operator->() {
+        return std::addressof(this->_val);
+    }
+
+    const T* operator->() const {
+        return std::addressof(this->_val);
+    }
+
+    E& error() & {
+        return this->_error;
+    }
+
+    const E& error() const& {
+        return this->_error;
+    }
+
+    E&& error() && {
+        return std::move(this->_error);
+    }
+
+    // checked access, throws if there is an error
+    T& value() & {
+        checkHasValue();
+        return this->_val;
+    }
+
+    const T& value() const& {
+        checkHasValue();
+        return this->_val;
+    }
+
+    T&& value() && {
+        checkHasValue();
+        return std::move(this->_val);
+    }
+
+    template <typename U>
+    T value_or(U&& fallback) const& {
+        return has_value() ? this->_val : static_cast<T>(std::forward<U>(fallback));
+    }
+
+    template <typename U>
+    T value_or(U&& fallback) && {
+        return has_value() ? std::move(this->_val) : static_cast<T>(std::forward<U>(fallback));
+    }
+
+    template <typename funcType>
+    auto operator>>=(funcType&& f) const& {
+        MONAD_COUNT_LVALUE_BIND();
+        using result_t = decltype(f(std::declval<const T&>()));
+        if (has_value()) {
+            return f(this->_val);
+        } else {
+            return result_t{make_unexpected(this->_error)};
+        }
+    }
+
+    // moves the value into f resp. the error into the result
+    template <typename funcType>
+    auto operator>>=(funcType&& f) && {
+        MONAD_COUNT_RVALUE_BIND();
+        using result_t = decltype(f(std::declval<T>()));
+        if (has_value()) {
+            return f(std::move(this->_val));
+        } else {
+            return result_t{make_unexpected(std::move(this->_error))};
+        }
+    }
+
+private:
+    void checkHasValue() const {
+        if (!has_value()) {
+            throw std::runtime_error("Accessed value of Expected holding an error");
+        }
+    }
+};
+
+namespace monad {
+    // the first error of the arguments, from left to right, is the result
+    template <>
+    struct native_applicative<Expected> : std::true_type {
+        template <typename funcType, typename T, typename E>
+        static auto fmap(funcType&& f, const Expected<T, E>& x) {
+            using result_t = Expected<std::decay_t<decltype(f(std::declval<const T&>()))>, E>;
+            return x.has_value() ? result_t{f(*x)} : result_t{make_unexpected(x.error())};
+        }
+
+        template <typename funcType, typename T, typename E>
+        static auto fmap(funcType&& f, Expected<T, E>&& x) {
+            using result_t = Expected<std::decay_t<decltype(f(std::declval<T>()))>, E>;
+            return x.has_value() ? result_t{f(*std::move(x))} : result_t{make_unexpected(std::move(x).error())};
+        }
+
+        template <typename funcType, typename T1, typename T2, typename E>
+        static auto liftA2(funcType&& f, const Expected<T1, E>& x, const Expected<T2, E>& y) {
+            using result_t = Expected<std::decay_t<decltype(f(std::declval<const T1&>(), std::declval<const T2&>()))>, E>;
+            if (!x.has_value()) {
+                return result_t{make_unexpected(x.error())};
+            }
+            return y.has_value() ? result_t{f(*x, *y)} : result_t{make_unexpected(y.error())};
+        }
+    };
+} // namespace monad
+#endif
@@ -0,0 +1,175 @@
+#ifndef FIXED_SEQ_H
+#define FIXED_SEQ_H
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "applicative.h"
+
+// fixed_seq<T> is the list monad on an inline array of fixed capacity, which
+// can be used in constant expressions, e.g. to compute lookup tables at
+// compile time:
+//
+//     constexpr auto table = monad::liftM2<fixed_seq>(multiplies{})(
+//         fixed_seq<int>{1, 2, 3}, fixed_seq<int>{1, 10});
+//     static_assert(table.size() == 6 && table[5] == 30, "");
+//
+// The capacity is a type, seq_capacity<N>, so that fixed_seq fits the
+// Monad<T, ...> shape of the monad combinators. T has to be a literal type
+// that is default constructible. Exceeding the capacity throws
+// std::length_error, which in a constant expression is a compile error.
+//
+// fmap keeps the capacity and liftA2 multiplies the capacities of its
+// operands. >>= keeps the capacity of the sequences returned by f, so a
+// chain of binds keeps its type and works with iterateM and foldM; if their
+// elements together may not fit, bind<seq_capacity<N>>(f) chooses a larger
+// capacity for the result.
+//
+// Before C++17 lambdas can't be called in constant expressions, named
+// function objects and function pointers can.
+
+template <std::size_t N>
+using seq_capacity = std::integral_constant<std::size_t, N>;
+
+template <typename T, typename Capacity = seq_capacity<16>>
+class fixed_seq {
+public:
+    using value_type = T;
+    using capacity_type = Capacity;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    constexpr fixed_seq()
+        : _elems{}
+        , _size{0} {
+    }
+
+    constexpr fixed_seq(std::initializer_list<T> elems)
+        : _elems{}
+        , _size{0} {
+        for (const auto& elem : elems) {
+            push_back(elem);
+        }
+    }
+
+    constexpr void push_back(const T& val) {
+        checkRoom();
+        _elems[_size++] = val;
+    }
+
+    constexpr void push_back(T&& val) {
+        checkRoom();
+        _elems[_size++] = std::move(val);
+    }
+
+    constexpr std::size_t size() const {
+        return _size;
+    }
+
+    static constexpr std::size_t capacity() {
+        return Capacity::value;
+    }
+
+    constexpr bool empty() const {
+        return _size == 0;
+    }
+
+    constexpr T& operator[](std::size_t i) {
+        return _elems[i];
+    }
+
+    constexpr const T& operator[](std::size_t i) const {
+        return _elems[i];
+    }
+
+    constexpr iterator begin() {
+        return _elems;
+    }
+
+    constexpr const_iterator begin() const {
+        return _elems;
+    }
+
+    constexpr iterator end() {
+        return _elems + _size;
+    }
+
+    constexpr const_iterator end() const {
+        return _elems + _size;
+    }
+
+    // the result has the capacity of the sequences returned by f
+    template <typename funcType>
+    constexpr auto operator>>=(funcType&& f) const {
+        using capacity_t = typename decltype(f(std::declval<const T&>()))::capacity_type;
+        return bind<capacity_t>(std::forward<funcType>(f));
+    }
+
+    // >>= with a result of capacity ResultCapacity
+    template <typename ResultCapacity, typename funcType>
+    constexpr auto bind(funcType&& f) const {
+        fixed_seq<typename decltype(f(std::declval<const T&>()))::value_type, ResultCapacity> returnSeq{};
+        for (std::size_t i = 0; i < _size; i++) {
+            const auto inner = f(_elems[i]);
+            for (std::size_t j = 0; j < inner.size(); j++) {
+                returnSeq.push_back(inner[j]);
+            }
+        }
+        return returnSeq;
+    }
+
+    friend constexpr bool operator==(const fixed_seq& s1, const fixed_seq& s2) {
+        if (s1._size != s2._size) {
+            return false;
+        }
+        for (std::size_t i = 0; i < s1._size; i++) {
+            if (!(s1._elems[i] == s2._elems[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    friend constexpr bool operator!=(const fixed_seq& s1, const fixed_seq& s2) {
+        return !(s1 == s2);
+    }
+
+private:
+    constexpr void checkRoom() const {
+        if (_size == Capacity::value) {
+            throw std::length_error("fixed_seq capacity exceeded");
+        }
+    }
+
+    T _elems[Capacity::value];
+    std::size_t _size;
+};
+
+namespace monad {
+    // fmap keeps the capacity, liftA2 multiplies the capacities
+    template <>
+    struct native_applicative<fixed_seq> : std::true_type {
+        template <typename funcType, typename T, typename C>
+        static constexpr auto fmap(funcType&& f, const fixed_seq<T, C>& x) {
+            fixed_seq<std::decay_t<decltype(f(std::declval<const T&>()))>, C> returnSeq{};
+            for (const auto& elem : x) {
+                returnSeq.push_back(f(elem));
+            }
+            return returnSeq;
+        }
+
+        template <typename funcType, typename T1, typename C1, typename T2, typename C2>
+        static constexpr auto liftA2(funcType&& f, const fixed_seq<T1, C1>& x, const fixed_seq<T2, C2>& y) {
+            fixed_seq<std::decay_t<decltype(f(std::declval<const T1&>(), std::declval<const T2&>()))>,
+                      seq_capacity<C1::value * C2::value>> returnSeq{};
+            for (const auto& elem1 : x) {
+                for (const auto& elem2 : y) {
+                    returnSeq.push_back(f(elem1, elem2));
+                }
+            }
+            return returnSeq;
+        }
+    };
+} // namespace monad
+#endif
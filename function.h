@@ -0,0 +1,217 @@
+#ifndef FUNCTION_H
+#define FUNCTION_H
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "monad.h"
+
+// unique_function<R(Args...)> is a move-only std::function that keeps
+// callables of up to BufferSize bytes, which covers the curried_fns and bind
+// lambdas of this library with a few captured arguments, inside the object
+// instead of on the heap. Callables that are larger, over-aligned or that
+// may throw when moved are allocated.
+//
+// Pipeline<Monad, T> chains a list of steps T -> Monad<T> that is only known
+// at runtime, e.g. assembled from a configuration:
+//
+//     Pipeline<Writer::Writer, int> pipeline{};
+//     for (const auto& name : config) {
+//         pipeline.then(stepNamed(name));
+//     }
+//     auto res = pipeline(writer(0, rope<std::string>{"start"}));
+//
+// Like the loops in monad.h, it stops at the first step that returns a value
+// ending the chain, e.g. an empty optional. As for monad.h, list.h and
+// vector.h have to be included before this header.
+template <typename Signature, std::size_t BufferSize = 64>
+class unique_function;
+
+template <typename R, typename... Args, std::size_t BufferSize>
+class unique_function<R(Args...), BufferSize> {
+public:
+    unique_function() noexcept
+        : _ops{nullptr} {
+    }
+
+    unique_function(std::nullptr_t) noexcept
+        : _ops{nullptr} {
+    }
+
+    template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, unique_function>::value
+                                                      && is_callable<std::decay_t<F>&(Args...)>::value>>
+    unique_function(F&& f)
+        : _ops{&ops_for<std::decay_t<F>>::table} {
+        ops_for<std::decay_t<F>>::construct(_storage, std::forward<F>(f));
+    }
+
+    unique_function(unique_function&& other) noexcept
+        : _ops{other._ops} {
+        if (_ops) {
+            _ops->move(other._storage, _storage);
+            other._ops = nullptr;
+        }
+    }
+
+    unique_function& operator=(unique_function&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other._ops) {
+                other._ops->move(other._storage, _storage);
+                _ops = std::exchange(other._ops, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    unique_function(const unique_function&) = delete;
+    unique_function& operator=(const unique_function&) = delete;
+
+    ~unique_function() {
+        reset();
+    }
+
+    // calls the callable as non-const and throws std::bad_function_call if
+    // there is none, like std::function
+    R operator()(Args... args) const {
+        if (!_ops) {
+            throw std::bad_function_call{};
+        }
+        return _ops->invoke(_storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept {
+        return _ops != nullptr;
+    }
+
+    // whether a callable of type F is stored without allocating
+    template <typename F>
+    static constexpr bool fits_inline() {
+        return ops_for<F>::isInline;
+    }
+
+private:
+    using storage_t = std::aligned_storage_t<BufferSize, alignof(std::max_align_t)>;
+
+    struct ops {
+        R (*invoke)(storage_t&, Args&&...);
+        // moves the callable in from into the empty to and destroys it in from
+        void (*move)(storage_t& from, storage_t& to) noexcept;
+        void (*destroy)(storage_t&) noexcept;
+    };
+
+    template <typename F, bool = sizeof(F) <= BufferSize && alignof(F) <= alignof(std::max_align_t)
+                                 && std::is_nothrow_move_constructible<F>::value>
+    struct ops_for {
+        static constexpr bool isInline = true;
+
+        template <typename G>
+        static void construct(storage_t& storage, G&& f) {
+            ::new (static_cast<void*>(&storage)) F(std::forward<G>(f));
+        }
+
+        static F& get(storage_t& storage) {
+            return *reinterpret_cast<F*>(&storage);
+        }
+
+        static R invoke(storage_t& storage, Args&&... args) {
+            return get(storage)(std::forward<Args>(args)...);
+        }
+
+        static void move(storage_t& from, storage_t& to) noexcept {
+            ::new (static_cast<void*>(&to)) F(std::move(get(from)));
+            get(from).~F();
+        }
+
+        static void destroy(storage_t& storage) noexcept {
+            get(storage).~F();
+        }
+
+        static constexpr ops table{&invoke, &move, &destroy};
+    };
+
+    // the buffer holds a pointer to the allocated callable
+    template <typename F>
+    struct ops_for<F, false> {
+        static constexpr bool isInline = false;
+
+        template <typename G>
+        static void construct(storage_t& storage, G&& f) {
+            ::new (static_cast<void*>(&storage)) F*(new F(std::forward<G>(f)));
+        }
+
+        static F*& get(storage_t& storage) {
+            return *reinterpret_cast<F**>(&storage);
+        }
+
+        static R invoke(storage_t& storage, Args&&... args) {
+            return (*get(storage))(std::forward<Args>(args)...);
+        }
+
+        static void move(storage_t& from, storage_t& to) noexcept {
+            ::new (static_cast<void*>(&to)) F*(get(from));
+        }
+
+        static void destroy(storage_t& storage) noexcept {
+            delete get(storage);
+        }
+
+        static constexpr ops table{&invoke, &move, &destroy};
+    };
+
+    void reset() noexcept {
+        if (_ops) {
+            _ops->destroy(_storage);
+            _ops = nullptr;
+        }
+    }
+
+    const ops* _ops;
+    mutable storage_t _storage;
+};
+
+template <typename R, typename... Args, std::size_t BufferSize>
+template <typename F, bool isInline>
+constexpr typename unique_function<R(Args...), BufferSize>::ops unique_function<R(Args...), BufferSize>::ops_for<F, isInline>::table;
+
+template <typename R, typename... Args, std::size_t BufferSize>
+template <typename F>
+constexpr typename unique_function<R(Args...), BufferSize>::ops unique_function<R(Args...), BufferSize>::ops_for<F, false>::table;
+
+template <template <typename, typename...> class Monad, typename T>
+class Pipeline {
+public:
+    using step_type = unique_function<Monad<T>(T)>;
+
+    Pipeline() = default;
+
+    // appends a step T -> Monad<T>
+    Pipeline& then(step_type step) {
+        _steps.push_back(std::move(step));
+        return *this;
+    }
+
+    void reserve(std::size_t n) {
+        _steps.reserve(n);
+    }
+
+    std::size_t size() const {
+        return _steps.size();
+    }
+
+    // x >>= step1 >>= step2 >>= ...
+    Monad<T> operator()(Monad<T> x) const {
+        for (auto it = _steps.begin(); it != _steps.end() && !monad::is_stopped(x, monad::short_circuits<Monad<T>>{}); ++it) {
+            x = std::move(x) >>= *it;
+        }
+        return x;
+    }
+
+private:
+    std::vector<step_type> _steps;
+};
+
+#endif
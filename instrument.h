@@ -0,0 +1,464 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+// Opt-in instrumentation of the monad headers. Compiled with
+// -DMONAD_INSTRUMENT, the binds of list, vector, optional and Writer, curry
+// and ap count their calls, and the following tools become active:
+//
+//     MONAD_TRACE_SCOPE("score requests");        // attributes everything
+//                                                 // until the end of the
+//                                                 // enclosing block here
+//     instrument::counted<payload>                // counts copies and moves
+//     std::list<T, instrument::allocator<T>>      // counts allocations
+//
+// Counts and elapsed time are collected per call site of MONAD_TRACE_SCOPE
+// (work outside of any scope goes to "(unscoped)") and can be written as a
+// text or JSON report or as a trace viewable in chrome://tracing or Perfetto:
+//
+//     instrument::registry::instance().write_text(std::cout);
+//     instrument::registry::instance().write_chrome_trace(traceFile);
+//
+// The "(unscoped)" counts of threads that are still running are included in
+// every report.
+//
+// Without MONAD_INSTRUMENT the macros expand to nothing, counted<T> is T and
+// instrument::allocator<T> is std::allocator<T>, so nothing is left of it.
+// With it the instrumented functions can't be evaluated at compile time, and
+// counted<T> holds the T, so code that should build both ways reaches the
+// value through instrument::value_of or a conversion to T&.
+
+#include <memory>
+
+#ifdef MONAD_INSTRUMENT
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace instrument {
+    enum class counter {
+        binds,
+        lvalue_binds,  // binds that copy out of their monadic value
+        rvalue_binds,  // binds that move out of it
+        curries,
+        aps,
+        copies,
+        moves,
+        allocations,
+        count
+    };
+
+    inline const char* counter_name(counter c) {
+        static const char* names[] = {"binds", "lvalue_binds", "rvalue_binds", "curries", "aps", "copies", "moves", "allocations"};
+        return names[static_cast<std::size_t>(c)];
+    }
+
+    constexpr std::size_t counterCount = static_cast<std::size_t>(counter::count);
+
+    struct site {
+        const char* name;
+        const char* file;
+        int line;
+
+        friend bool operator<(const site& s1, const site& s2) {
+            return std::make_tuple(std::string(s1.file), s1.line, std::string(s1.name))
+                 < std::make_tuple(std::string(s2.file), s2.line, std::string(s2.name));
+        }
+    };
+
+    struct site_stats {
+        std::size_t calls = 0;
+        std::uint64_t nanoseconds = 0;
+        std::uint64_t counts[counterCount] = {};
+    };
+
+    struct trace_event {
+        site where;
+        std::uint64_t start;
+        std::uint64_t duration;
+        std::size_t thread;
+        std::uint64_t counts[counterCount];
+    };
+
+    inline std::uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // the counts of a thread outside of any scope; only the thread adds to
+    // them, the registry reads them whenever a report is taken
+    struct unscoped_counts {
+        std::atomic<std::uint64_t> counts[counterCount] = {};
+        std::atomic<std::uint64_t> start{now()};
+
+        void add(counter c, std::uint64_t n) {
+            counts[static_cast<std::size_t>(c)].fetch_add(n, std::memory_order_relaxed);
+        }
+    };
+
+    // collects the statistics of all threads
+    class registry {
+    public:
+        static registry& instance() {
+            static registry reg;
+            return reg;
+        }
+
+        void record(const site& where, std::uint64_t start, std::uint64_t duration, const std::uint64_t* counts) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            recordLocked(where, start, duration, counts);
+        }
+
+        // the unscoped counts of a thread are part of every report from the
+        // thread's first count outside of a scope until it ends
+        void attach(unscoped_counts& counts) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _unscoped.push_back(&counts);
+        }
+
+        void detach(unscoped_counts& counts) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _unscoped.erase(std::remove(_unscoped.begin(), _unscoped.end(), &counts), _unscoped.end());
+            std::uint64_t values[counterCount];
+            load(counts, values);
+            const std::uint64_t start = counts.start.load(std::memory_order_relaxed);
+            recordLocked(unscopedSite(), start, now() - start, values);
+        }
+
+        void reset() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _sites.clear();
+            _events.clear();
+            for (unscoped_counts* counts : _unscoped) {
+                for (auto& count : counts->counts) {
+                    count.store(0, std::memory_order_relaxed);
+                }
+                counts->start.store(now(), std::memory_order_relaxed);
+            }
+        }
+
+        // the statistics of the finished scopes and threads, and the counts
+        // of the running threads so far
+        std::map<site, site_stats> sites() const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::map<site, site_stats> returnSites = _sites;
+            for (const unscoped_counts* counts : _unscoped) {
+                std::uint64_t values[counterCount];
+                load(*counts, values);
+                auto& stats = returnSites[unscopedSite()];
+                stats.calls++;
+                stats.nanoseconds += now() - counts->start.load(std::memory_order_relaxed);
+                for (std::size_t i = 0; i < counterCount; i++) {
+                    stats.counts[i] += values[i];
+                }
+            }
+            return returnSites;
+        }
+
+        void write_text(std::ostream& out) const {
+            for (const auto& entry : sites()) {
+                out << entry.first.name << " (" << entry.first.file << ":" << entry.first.line << ")\n"
+                    << "    calls: " << entry.second.calls
+                    << ", time: " << entry.second.nanoseconds / 1000.0 << "us\n   ";
+                for (std::size_t i = 0; i < counterCount; i++) {
+                    out << " " << counter_name(static_cast<counter>(i)) << ": " << entry.second.counts[i];
+                }
+                out << "\n";
+            }
+        }
+
+        void write_json(std::ostream& out) const {
+            out << "[";
+            const char* separator = "\n";
+            for (const auto& entry : sites()) {
+                out << separator << "  {\"name\": \"" << escaped(entry.first.name)
+                    << "\", \"file\": \"" << escaped(entry.first.file) << "\", \"line\": " << entry.first.line
+                    << ", \"calls\": " << entry.second.calls << ", \"ns\": " << entry.second.nanoseconds;
+                writeCounts(out, entry.second.counts);
+                out << "}";
+                separator = ",\n";
+            }
+            out << "\n]\n";
+        }
+
+        // trace event format with one complete event per scope
+        void write_chrome_trace(std::ostream& out) const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            out << "{\"traceEvents\": [";
+            const char* separator = "\n";
+            for (const auto& event : _events) {
+                out << separator << "  {\"name\": \"" << escaped(event.where.name) << "\", \"cat\": \"monad\", \"ph\": \"X\""
+                    << ", \"ts\": " << microseconds(event.start) << ", \"dur\": " << microseconds(event.duration)
+                    << ", \"pid\": 1, \"tid\": " << event.thread << ", \"args\": {\"site\": \""
+                    << escaped(event.where.file) << ":" << event.where.line << "\"";
+                writeCounts(out, event.counts);
+                out << "}}";
+                separator = ",\n";
+            }
+            out << "\n], \"displayTimeUnit\": \"ns\"}\n";
+        }
+
+    private:
+        static constexpr std::size_t maxEvents = 1 << 20;
+
+        static site unscopedSite() {
+            return site{"(unscoped)", "", 0};
+        }
+
+        static void load(const unscoped_counts& counts, std::uint64_t* values) {
+            for (std::size_t i = 0; i < counterCount; i++) {
+                values[i] = counts.counts[i].load(std::memory_order_relaxed);
+            }
+        }
+
+        void recordLocked(const site& where, std::uint64_t start, std::uint64_t duration, const std::uint64_t* counts) {
+            auto& stats = _sites[where];
+            stats.calls++;
+            stats.nanoseconds += duration;
+            for (std::size_t i = 0; i < counterCount; i++) {
+                stats.counts[i] += counts[i];
+            }
+            if (_events.size() < maxEvents) {
+                trace_event event{where, start, duration, threadIndex(), {}};
+                std::copy(counts, counts + counterCount, event.counts);
+                _events.push_back(event);
+            }
+        }
+
+        static std::string escaped(const char* str) {
+            std::string returnStr{};
+            for (; *str; ++str) {
+                if (*str == '"' || *str == '\\') {
+                    returnStr.push_back('\\');
+                }
+                returnStr.push_back(*str);
+            }
+            return returnStr;
+        }
+
+        // trace timestamps are microseconds, printed in full with ns digits
+        static std::string microseconds(std::uint64_t nanoseconds) {
+            std::string fraction = std::to_string(nanoseconds % 1000);
+            return std::to_string(nanoseconds / 1000) + "." + std::string(3 - fraction.size(), '0') + fraction;
+        }
+
+        static void writeCounts(std::ostream& out, const std::uint64_t* counts) {
+            for (std::size_t i = 0; i < counterCount; i++) {
+                out << ", \"" << counter_name(static_cast<counter>(i)) << "\": " << counts[i];
+            }
+        }
+
+        // small stable thread ids for the trace
+        std::size_t threadIndex() {
+            auto id = std::this_thread::get_id();
+            auto it = _threads.find(id);
+            if (it == _threads.end()) {
+                it = _threads.emplace(id, _threads.size()).first;
+            }
+            return it->second;
+        }
+
+        mutable std::mutex _mutex;
+        std::map<site, site_stats> _sites;
+        std::vector<trace_event> _events;
+        std::map<std::thread::id, std::size_t> _threads;
+        std::vector<unscoped_counts*> _unscoped;
+    };
+
+    // the innermost scope of a thread, counters are only touched by it
+    class scope {
+    public:
+        scope(const char* name, const char* file, int line)
+            : _where{name, file, line}
+            , _parent{current()}
+            , _counts{}
+            , _start{now()} {
+            current() = this;
+        }
+
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+        ~scope() {
+            current() = _parent;
+            registry::instance().record(_where, _start, now() - _start, _counts);
+        }
+
+        static void count(counter c, std::uint64_t n = 1) {
+            if (scope* active = current()) {
+                active->_counts[static_cast<std::size_t>(c)] += n;
+            } else {
+                unscoped().add(c, n);
+            }
+        }
+
+    private:
+        // the unscoped counts of the current thread, attached to the
+        // registry while the thread runs
+        struct attached_counts : unscoped_counts {
+            attached_counts() {
+                registry::instance().attach(*this);
+            }
+
+            ~attached_counts() {
+                registry::instance().detach(*this);
+            }
+        };
+
+        static scope*& current() {
+            static thread_local scope* active = nullptr;
+            return active;
+        }
+
+        static unscoped_counts& unscoped() {
+            static thread_local attached_counts counts;
+            return counts;
+        }
+
+        site _where;
+        scope* _parent;
+        std::uint64_t _counts[counterCount];
+        std::uint64_t _start;
+    };
+
+    // a T that counts its copies and moves. The value is a member, so T may
+    // be any copyable type, e.g. int or a final class; it converts to T&,
+    // see also value_of
+    template <typename T>
+    class counted {
+        // the arguments of a copy or move, which are counted
+        template <typename... Args>
+        struct is_copy : std::false_type {};
+
+        template <typename Arg>
+        struct is_copy<Arg> : std::integral_constant<bool, std::is_same<std::decay_t<Arg>, T>::value
+                                                           || std::is_same<std::decay_t<Arg>, counted>::value> {};
+
+    public:
+        counted() = default;
+
+        template <typename... Args, typename = std::enable_if_t<!is_copy<Args...>::value && std::is_constructible<T, Args&&...>::value>>
+        counted(Args&&... args)
+            : _val(std::forward<Args>(args)...) {
+        }
+
+        counted(const T& val)
+            : _val(val) {
+            scope::count(counter::copies);
+        }
+
+        counted(T&& val)
+            : _val(std::move(val)) {
+            scope::count(counter::moves);
+        }
+
+        counted(const counted& other)
+            : _val(other._val) {
+            scope::count(counter::copies);
+        }
+
+        counted(counted&& other)
+            : _val(std::move(other._val)) {
+            scope::count(counter::moves);
+        }
+
+        counted& operator=(const counted& other) {
+            _val = other._val;
+            scope::count(counter::copies);
+            return *this;
+        }
+
+        counted& operator=(counted&& other) {
+            _val = std::move(other._val);
+            scope::count(counter::moves);
+            return *this;
+        }
+
+        operator T&() {
+            return _val;
+        }
+
+        operator const T&() const {
+            return _val;
+        }
+
+    private:
+        T _val{};
+    };
+
+    // the value of a counted<T>, e.g. to reach the members of a class T; it
+    // is the identity without MONAD_INSTRUMENT, so code using it builds
+    // either way
+    template <typename T>
+    T& value_of(counted<T>& x) {
+        return x;
+    }
+
+    template <typename T>
+    const T& value_of(const counted<T>& x) {
+        return x;
+    }
+
+    // std::allocator that counts its allocations
+    template <typename T>
+    class allocator : public std::allocator<T> {
+    public:
+        template <typename U>
+        struct rebind {
+            using other = allocator<U>;
+        };
+
+        allocator() = default;
+
+        template <typename U>
+        allocator(const allocator<U>&) noexcept {
+        }
+
+        T* allocate(std::size_t n) {
+            scope::count(counter::allocations);
+            return std::allocator<T>::allocate(n);
+        }
+    };
+} // namespace instrument
+
+#define MONAD_INSTRUMENT_CONCAT_IMPL(a, b) a##b
+#define MONAD_INSTRUMENT_CONCAT(a, b) MONAD_INSTRUMENT_CONCAT_IMPL(a, b)
+#define MONAD_TRACE_SCOPE(name) \
+    ::instrument::scope MONAD_INSTRUMENT_CONCAT(monadTraceScope, __LINE__)(name, __FILE__, __LINE__)
+#define MONAD_COUNT(c) ::instrument::scope::count(::instrument::counter::c)
+
+#else
+
+namespace instrument {
+    template <typename T>
+    using counted = T;
+
+    template <typename T>
+    T& value_of(T& x) {
+        return x;
+    }
+
+    template <typename T>
+    using allocator = std::allocator<T>;
+} // namespace instrument
+
+#define MONAD_TRACE_SCOPE(name)
+#define MONAD_COUNT(c) static_cast<void>(0)
+
+#endif
+
+// counts a bind on an lvalue resp. rvalue monadic value
+#define MONAD_COUNT_LVALUE_BIND() (MONAD_COUNT(binds), MONAD_COUNT(lvalue_binds))
+#define MONAD_COUNT_RVALUE_BIND() (MONAD_COUNT(binds), MONAD_COUNT(rvalue_binds))
+
+#endif
@@ -1,30 +1,109 @@
 #ifndef LIST_H
 #define LIST_H
 #include <list>
+#include <memory>
+#include "applicative.h"
 #include "cpp17.h"
+#include "instrument.h"
 #include "type_traits.h"
 
 
-template <typename T, typename funcType>
-auto operator>>= (const std::list<T>& list, funcType&& f)
+// The binds and the applicative operations build their result with the
+// allocator of their input, rebound to the new element type where the result
+// type allows it, so pipelines over lists with a custom allocator keep
+// allocating from it.
+//
+// The inner lists returned by f are spliced into the result of >>= instead of
+// copied node by node, so a bind allocates no nodes beyond those f creates.
+// Nodes can only move between lists with equal allocators, inner lists with
+// a different allocator are moved element by element.
+
+namespace detail {
+    template <typename T, typename A>
+    void append_list(std::list<T, A>& returnList, std::list<T, A>&& inner) {
+        if (returnList.get_allocator() == inner.get_allocator()) {
+            returnList.splice(returnList.end(), inner);
+        } else {
+            for (auto& elem : inner) {
+                returnList.push_back(std::move(elem));
+            }
+        }
+    }
+} // namespace detail
+
+template <typename T, typename A, typename funcType>
+auto operator>>= (const std::list<T, A>& list, funcType&& f)
     -> std::enable_if_t<is_container<std::list, decltype(f(std::declval<T>()))>{}(), decltype(f(std::declval<T>()))> {
-        decltype(f(std::declval<T>())) returnList{};
+        MONAD_COUNT_LVALUE_BIND();
+        auto returnList = empty_with_allocator<decltype(f(std::declval<T>()))>(list.get_allocator());
         for (const auto& elem : list) {
-            for (auto&& elem2 : f(elem)) {
-                returnList.push_back(std::forward<decltype(elem2)>(elem2));
-            }
+            detail::append_list(returnList, f(elem));
         }
         return returnList;
 }
 
-template <typename T, typename funcType>
-auto operator>>= (std::list<T>&& list, funcType&& f) -> std::enable_if_t<is_container<std::list, decltype(f(std::declval<T>()))>{}(), decltype(f(std::declval<T>()))> {
-    decltype(f(std::declval<T>())) returnList{};
-    for (auto&& elem : std::move(list)) {
-        for (auto&& elem2: f(std::move(elem))) {
-            returnList.push_back(std::move(elem2));
-        }
+template <typename T, typename A, typename funcType>
+auto operator>>= (std::list<T, A>&& list, funcType&& f) -> std::enable_if_t<is_container<std::list, decltype(f(std::declval<T>()))>{}(), decltype(f(std::declval<T>()))> {
+    MONAD_COUNT_RVALUE_BIND();
+    auto returnList = empty_with_allocator<decltype(f(std::declval<T>()))>(list.get_allocator());
+    for (auto&& elem : list) {
+        detail::append_list(returnList, f(std::move(elem)));
     }
     return returnList;
 }
+
+namespace monad {
+    template <>
+    struct native_applicative<std::list> : std::true_type {
+        template <typename U, typename A>
+        using rebound_list = std::list<U, typename std::allocator_traits<A>::template rebind_alloc<U>>;
+
+        template <typename funcType, typename T, typename A>
+        static auto fmap(funcType&& f, const std::list<T, A>& x) {
+            using result_t = rebound_list<std::decay_t<decltype(f(std::declval<const T&>()))>, A>;
+            result_t returnList(typename result_t::allocator_type(x.get_allocator()));
+            for (const auto& elem : x) {
+                returnList.push_back(f(elem));
+            }
+            return returnList;
+        }
+
+        // reuses the nodes of x if f keeps the element type
+        template <typename funcType, typename T, typename A>
+        static auto fmap(funcType&& f, std::list<T, A>&& x) {
+            using result_t = rebound_list<std::decay_t<decltype(f(std::declval<T>()))>, A>;
+            return fmapImpl<result_t>(std::is_same<result_t, std::list<T, A>>{}, f, std::move(x));
+        }
+
+        template <typename funcType, typename T1, typename A1, typename T2, typename A2>
+        static auto liftA2(funcType&& f, const std::list<T1, A1>& x, const std::list<T2, A2>& y) {
+            using result_t = rebound_list<std::decay_t<decltype(f(std::declval<const T1&>(), std::declval<const T2&>()))>, A1>;
+            result_t returnList(typename result_t::allocator_type(x.get_allocator()));
+            for (const auto& elem1 : x) {
+                for (const auto& elem2 : y) {
+                    returnList.push_back(f(elem1, elem2));
+                }
+            }
+            return returnList;
+        }
+
+    private:
+        template <typename result_t, typename funcType, typename T, typename A>
+        static result_t fmapImpl(std::true_type, funcType& f, std::list<T, A>&& x) {
+            for (auto& elem : x) {
+                elem = f(std::move(elem));
+            }
+            return std::move(x);
+        }
+
+        template <typename result_t, typename funcType, typename T, typename A>
+        static result_t fmapImpl(std::false_type, funcType& f, std::list<T, A>&& x) {
+            result_t returnList(typename result_t::allocator_type(x.get_allocator()));
+            for (auto&& elem : x) {
+                returnList.push_back(f(std::move(elem)));
+            }
+            return returnList;
+        }
+    };
+} // namespace monad
 #endif
@@ -0,0 +1,266 @@
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Log sinks for a Writer whose log is streamed out instead of accumulated:
+// with W = sink_log every entry is appended to a sink the moment it is told,
+// and the log carried through >>= is just the number of entries, so a
+// computation runs in constant memory no matter how many entries it writes.
+// runWriter and execWriter hand out that number instead of the entries:
+//
+//     file_sink audit("audit.log");
+//     auto step = [&audit] (int x) { return writer(x + 1, log_to(audit, "step")); };
+//     auto res = runWriter(writer(0, log_to(audit, "start")) >>= step);  // (1, 2)
+//
+// Entries are written in the order the log_to calls are evaluated. In a >>=
+// chain, and in the loops of monad.h, each step is evaluated after the steps
+// before it, so that is the order of the log. The operands of liftM2, ap and
+// other calls taking several Writers are evaluated by the caller, in the
+// order C++ evaluates the arguments of a call, which is unspecified;
+// evaluate them in separate statements when their order in the sink
+// matters. A log that is used several times, e.g. by replicateM_, is counted
+// each time but was written once. Sinks aren't synchronized, a sink must
+// only be used by one thread at a time.
+
+class log_sink {
+public:
+    virtual ~log_sink() = default;
+
+    virtual void append(const std::string& entry) = 0;
+
+    // writes buffered entries through to the underlying storage
+    virtual void flush() {
+    }
+};
+
+// the log of a Writer streaming into sinks, the number of entries told
+class sink_log {
+public:
+    sink_log()
+        : _entries{0} {
+    }
+
+    explicit sink_log(std::size_t entries)
+        : _entries{entries} {
+    }
+
+    std::size_t entries() const {
+        return _entries;
+    }
+
+    friend sink_log operator+(const sink_log& l1, const sink_log& l2) {
+        return sink_log{l1._entries + l2._entries};
+    }
+
+    // the entries are in their sinks already, runWriter only hands out
+    // their number
+    friend std::size_t materialize(const sink_log& log) {
+        return log._entries;
+    }
+
+    friend std::size_t materialize(sink_log&& log) {
+        return log._entries;
+    }
+
+private:
+    std::size_t _entries;
+};
+
+// appends entry to sink and returns the log consisting of it
+inline sink_log log_to(log_sink& sink, const std::string& entry) {
+    sink.append(entry);
+    return sink_log{1};
+}
+
+// keeps the last capacity entries in memory
+class ring_sink : public log_sink {
+public:
+    explicit ring_sink(std::size_t capacity)
+        : _entries(std::max<std::size_t>(capacity, 1))
+        , _next{0}
+        , _written{0} {
+    }
+
+    void append(const std::string& entry) override {
+        _entries[_next] = entry;
+        _next = (_next + 1) % _entries.size();
+        _written++;
+    }
+
+    // the retained entries, oldest first
+    std::vector<std::string> entries() const {
+        std::vector<std::string> returnVec{};
+        const std::size_t count = std::min(_written, _entries.size());
+        returnVec.reserve(count);
+        for (std::size_t i = 0; i < count; i++) {
+            returnVec.push_back(_entries[(_next + _entries.size() - count + i) % _entries.size()]);
+        }
+        return returnVec;
+    }
+
+    // number of entries that were overwritten
+    std::size_t dropped() const {
+        return _written - std::min(_written, _entries.size());
+    }
+
+private:
+    std::vector<std::string> _entries;
+    std::size_t _next;
+    std::size_t _written;
+};
+
+// appends the entries as lines to a file, buffering at most bufferSize bytes
+class file_sink : public log_sink {
+public:
+    explicit file_sink(const std::string& path, std::size_t bufferSize = 1 << 16)
+        : _file{std::fopen(path.c_str(), "ab")}
+        , _bufferSize{bufferSize} {
+        if (!_file) {
+            throw std::runtime_error("Could not open log file " + path);
+        }
+        _buffer.reserve(_bufferSize);
+    }
+
+    file_sink(const file_sink&) = delete;
+    file_sink& operator=(const file_sink&) = delete;
+
+    // a failing write can't be reported from here, flush() first to see it
+    ~file_sink() override {
+        try {
+            writeBuffer();
+        } catch (const std::runtime_error&) {
+        }
+        std::fclose(_file);
+    }
+
+    void append(const std::string& entry) override {
+        if (_buffer.size() + entry.size() + 1 > _bufferSize) {
+            writeBuffer();
+        }
+        _buffer.append(entry);
+        _buffer.push_back('\n');
+    }
+
+    // throws if the entries couldn't be written
+    void flush() override {
+        writeBuffer();
+        if (std::fflush(_file) != 0) {
+            throw std::runtime_error("Could not write to log file");
+        }
+    }
+
+private:
+    void writeBuffer() {
+        if (!_buffer.empty() && std::fwrite(_buffer.data(), 1, _buffer.size(), _file) != _buffer.size()) {
+            throw std::runtime_error("Could not write to log file");
+        }
+        _buffer.clear();
+    }
+
+    std::FILE* _file;
+    std::size_t _bufferSize;
+    std::string _buffer;
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+// appends the entries as lines to a file through a memory mapped window of
+// windowSize bytes that moves along the end of the file
+class mmap_sink : public log_sink {
+public:
+    explicit mmap_sink(const std::string& path, std::size_t windowSize = 1 << 20)
+        : _fd{::open(path.c_str(), O_RDWR | O_CREAT, 0644)}
+        , _pageSize{static_cast<std::size_t>(::sysconf(_SC_PAGESIZE))}
+        , _windowSize{std::max(windowSize, _pageSize)}
+        , _window{nullptr}
+        , _windowStart{0}
+        , _windowEnd{0}
+        , _size{0} {
+        if (_fd < 0) {
+            throw std::runtime_error("Could not open log file " + path);
+        }
+        struct stat status;
+        if (::fstat(_fd, &status) != 0) {
+            ::close(_fd);
+            throw std::runtime_error("Could not stat log file " + path);
+        }
+        _size = static_cast<std::size_t>(status.st_size);
+    }
+
+    mmap_sink(const mmap_sink&) = delete;
+    mmap_sink& operator=(const mmap_sink&) = delete;
+
+    // cuts off the unused rest of the last window
+    ~mmap_sink() override {
+        unmap();
+        if (::ftruncate(_fd, static_cast<off_t>(_size)) != 0) {
+            // nothing sensible to do about it in a destructor
+        }
+        ::close(_fd);
+    }
+
+    void append(const std::string& entry) override {
+        const std::size_t needed = entry.size() + 1;
+        if (!_window || _size + needed > _windowEnd) {
+            remap(needed);
+        }
+        char* dest = _window + (_size - _windowStart);
+        std::memcpy(dest, entry.data(), entry.size());
+        dest[entry.size()] = '\n';
+        _size += needed;
+    }
+
+    void flush() override {
+        if (_window && ::msync(_window, _size - _windowStart, MS_ASYNC) != 0) {
+            throw std::runtime_error("Could not sync log file");
+        }
+    }
+
+private:
+    // maps a window starting at the page containing the end of the file that
+    // has room for at least needed bytes
+    void remap(std::size_t needed) {
+        unmap();
+        _windowStart = _size / _pageSize * _pageSize;
+        std::size_t length = _size - _windowStart + std::max(needed, _windowSize);
+        length = (length + _pageSize - 1) / _pageSize * _pageSize;
+        if (::ftruncate(_fd, static_cast<off_t>(_windowStart + length)) != 0) {
+            throw std::runtime_error("Could not grow log file");
+        }
+        void* window = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, static_cast<off_t>(_windowStart));
+        if (window == MAP_FAILED) {
+            throw std::runtime_error("Could not map log file");
+        }
+        _window = static_cast<char*>(window);
+        _windowEnd = _windowStart + length;
+    }
+
+    void unmap() {
+        if (_window) {
+            ::munmap(_window, _windowEnd - _windowStart);
+            _window = nullptr;
+        }
+    }
+
+    int _fd;
+    std::size_t _pageSize;
+    std::size_t _windowSize;
+    char* _window;
+    std::size_t _windowStart;
+    std::size_t _windowEnd;
+    std::size_t _size;
+};
+#endif
+
+#endif
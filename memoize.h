@@ -0,0 +1,242 @@
+#ifndef MEMOIZE_H
+#define MEMOIZE_H
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "cpp17.h"
+
+// memoize(f) caches the results of a pure function f keyed on its arguments.
+// It has the single call signature of f, so it can be curried like f itself
+// and then caches every full application by the tuple of captured arguments:
+//
+//     auto score = curry(memoize([] (const user& u, const item& i) { ... }));
+//     auto scores = monad::liftM2<std::vector>(score)(users, items);
+//
+// f needs a unique, non-template call signature and the decayed parameter
+// types must be hashable with std::hash and comparable with ==. Copies of a
+// memoized function share their cache, which is safe to use from several
+// threads: it is split into shards with a lock each, chosen by the hash of
+// the arguments. f is called without holding a lock, so two threads missing
+// the same arguments at once both compute the result.
+
+enum class memo_eviction {
+    lru,   // drops the least recently used result
+    fifo,  // drops the oldest result, hits don't reorder anything
+    none   // keeps everything
+};
+
+struct memo_options {
+    // maximal number of cached results, split evenly among the shards; with
+    // fewer results than shards there is one shard per result
+    std::size_t capacity = 1 << 16;
+    std::size_t shards = 16;
+    memo_eviction eviction = memo_eviction::lru;
+};
+
+struct memo_stats {
+    std::size_t hits;
+    std::size_t misses;
+    std::size_t evictions;
+    std::size_t size;
+};
+
+namespace detail {
+    // the call signature of callables with exactly one, non-template one
+    template <typename F, typename = void>
+    struct call_signature;
+
+    template <typename R, typename... Args>
+    struct call_signature<R(*)(Args...)> {
+        using result_type = R;
+        using key_type = std::tuple<std::decay_t<Args>...>;
+    };
+
+    template <typename>
+    struct member_call_signature;
+
+    template <typename R, typename C, typename... Args>
+    struct member_call_signature<R (C::*)(Args...)> : call_signature<R(*)(Args...)> {};
+
+    template <typename R, typename C, typename... Args>
+    struct member_call_signature<R (C::*)(Args...) const> : call_signature<R(*)(Args...)> {};
+
+#ifdef __cpp_noexcept_function_type
+    // since C++17 noexcept is part of the type
+    template <typename R, typename... Args>
+    struct call_signature<R(*)(Args...) noexcept> : call_signature<R(*)(Args...)> {};
+
+    template <typename R, typename C, typename... Args>
+    struct member_call_signature<R (C::*)(Args...) noexcept> : call_signature<R(*)(Args...)> {};
+
+    template <typename R, typename C, typename... Args>
+    struct member_call_signature<R (C::*)(Args...) const noexcept> : call_signature<R(*)(Args...)> {};
+#endif
+
+    template <typename F>
+    struct call_signature<F, void_t<decltype(&F::operator())>> : member_call_signature<decltype(&F::operator())> {};
+
+    inline void hash_combine(std::size_t& seed, std::size_t hash) {
+        seed ^= hash + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    }
+
+    template <typename Tuple>
+    struct tuple_hash {
+        std::size_t operator()(const Tuple& key) const {
+            return hash(key, std::make_index_sequence<std::tuple_size<Tuple>::value>{});
+        }
+
+    private:
+        template <std::size_t... I>
+        static std::size_t hash(const Tuple& key, std::index_sequence<I...>) {
+            std::size_t seed = 0;
+            (void)std::initializer_list<int>{(hash_combine(seed, std::hash<std::tuple_element_t<I, Tuple>>{}(std::get<I>(key))), 0)...};
+            return seed;
+        }
+    };
+
+    template <typename Key, typename Value>
+    class memo_cache {
+    public:
+        // the capacity is shared out among the shards, there are no more
+        // shards than results to cache so that the total stays within it
+        explicit memo_cache(const memo_options& options)
+            : _shards(shardCount(options))
+            , _eviction{options.eviction}
+            , _hits{0}
+            , _misses{0}
+            , _evictions{0} {
+            if (_eviction != memo_eviction::none) {
+                const std::size_t capacity = std::max<std::size_t>(options.capacity, 1);
+                for (std::size_t i = 0; i < _shards.size(); i++) {
+                    _shards[i].capacity = capacity / _shards.size() + (i < capacity % _shards.size() ? 1 : 0);
+                }
+            }
+        }
+
+        template <typename Compute>
+        Value get(const Key& key, Compute&& compute) {
+            const std::size_t hash = tuple_hash<Key>{}(key);
+            shard& s = _shards[hash % _shards.size()];
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                auto it = s.index.find(key);
+                if (it != s.index.end()) {
+                    if (_eviction == memo_eviction::lru) {
+                        s.entries.splice(s.entries.begin(), s.entries, it->second);
+                    }
+                    _hits.fetch_add(1, std::memory_order_relaxed);
+                    return it->second->second;
+                }
+            }
+            _misses.fetch_add(1, std::memory_order_relaxed);
+            Value val = compute();
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (s.index.find(key) == s.index.end()) {
+                s.entries.emplace_front(key, val);
+                s.index.emplace(key, s.entries.begin());
+                if (s.capacity > 0 && s.entries.size() > s.capacity) {
+                    s.index.erase(s.entries.back().first);
+                    s.entries.pop_back();
+                    _evictions.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            return val;
+        }
+
+        memo_stats stats() const {
+            std::size_t size = 0;
+            for (auto& s : _shards) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                size += s.entries.size();
+            }
+            return memo_stats{_hits.load(), _misses.load(), _evictions.load(), size};
+        }
+
+        void clear() {
+            for (auto& s : _shards) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.index.clear();
+                s.entries.clear();
+            }
+        }
+
+    private:
+        // the entries are ordered by recency resp. insertion, newest first;
+        // a capacity of 0 means unbounded
+        struct shard {
+            mutable std::mutex mutex;
+            std::list<std::pair<Key, Value>> entries;
+            std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator, tuple_hash<Key>> index;
+            std::size_t capacity = 0;
+        };
+
+        static std::size_t shardCount(const memo_options& options) {
+            std::size_t count = std::max<std::size_t>(options.shards, 1);
+            if (options.eviction != memo_eviction::none) {
+                count = std::min(count, std::max<std::size_t>(options.capacity, 1));
+            }
+            return count;
+        }
+
+        std::vector<shard> _shards;
+        memo_eviction _eviction;
+        std::atomic<std::size_t> _hits;
+        std::atomic<std::size_t> _misses;
+        std::atomic<std::size_t> _evictions;
+    };
+
+    template <typename F, typename Signature>
+    class memoized_fn;
+
+    template <typename F, typename R, typename... Args>
+    class memoized_fn<F, R(Args...)> {
+    public:
+        using result_type = std::decay_t<R>;
+
+        memoized_fn(F f, const memo_options& options)
+            : _f{std::move(f)}
+            , _cache{std::make_shared<memo_cache<std::tuple<std::decay_t<Args>...>, result_type>>(options)} {
+        }
+
+        result_type operator()(const std::decay_t<Args>&... args) const {
+            return _cache->get(std::tuple<std::decay_t<Args>...>{args...}, [&] { return _f(args...); });
+        }
+
+        memo_stats stats() const {
+            return _cache->stats();
+        }
+
+        void clear() const {
+            _cache->clear();
+        }
+
+    private:
+        F _f;
+        std::shared_ptr<memo_cache<std::tuple<std::decay_t<Args>...>, result_type>> _cache;
+    };
+
+    template <typename F, typename = typename call_signature<F>::key_type>
+    struct memoized_signature;
+
+    template <typename F, typename... Args>
+    struct memoized_signature<F, std::tuple<Args...>> {
+        using type = typename call_signature<F>::result_type(Args...);
+    };
+} // namespace detail
+
+template <typename F>
+auto memoize(F&& f, const memo_options& options = memo_options{}) {
+    using func_type = std::decay_t<F>;
+    return detail::memoized_fn<func_type, typename detail::memoized_signature<func_type>::type>(std::forward<F>(f), options);
+}
+
+#endif
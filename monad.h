@@ -1,6 +1,12 @@
 #ifndef MONAD_H
 #define MONAD_H
+#include "applicative.h"
 #include "curry.h"
+#include "instrument.h"
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
 #include <type_traits>
 #include "cpp17.h"
 #include "type_traits.h"
@@ -31,52 +37,271 @@ namespace monad {
     template <typename>
     struct is_monadic_type : std::false_type {};
 
-    template <template <typename, typename...> class Monad, typename T>
-    struct is_monadic_type<Monad<T>> : is_monad<Monad> {};
+    template <template <typename, typename...> class Monad, typename T, typename... Rest>
+    struct is_monadic_type<Monad<T, Rest...>> : is_monad<Monad> {};
 
     template <typename T>
     decltype(auto) join(T& x) {
+        static_assert(is_monadic_type<std::remove_const_t<T>>{}() && is_nested_container<std::remove_const_t<T>>{}(),
+            "join can only be called on an argument of type Monad<Monad<T>> where T is an arbitrary type.");
+        return x >>= [] (const auto& val) { return val; };
+    }
+
+    // moves the inner values out of x, which lets the list monad splice the
+    // inner lists instead of copying them
+    template <typename T, typename = std::enable_if_t<!std::is_lvalue_reference<T>::value>>
+    decltype(auto) join(T&& x) {
         static_assert(is_monadic_type<T>{}() && is_nested_container<T>{}(),
             "join can only be called on an argument of type Monad<Monad<T>> where T is an arbitrary type.");
-        return x >>= [] (auto val) { return val; };
+        return std::move(x) >>= [] (auto&& val) { return std::move(val); };
     }
 
-    template <template <typename, typename...> class Monad, typename T, typename funcType>
-    auto fmap(funcType&& f, const Monad<T>& x) {
-        static_assert(is_monad<Monad>{}(), "expected type: Monad<T> for some monad type constructor 'Monad' and some type T \n actual type: ");
+    // applies a function taken out of a monad to the next value; functions
+    // that need further arguments are curried first
+    struct apply_partially {
+        template <typename funcType, typename T>
+        constexpr auto operator()(const funcType& f, T&& val) const {
+            return impl(is_callable<const funcType&(T&&)>{}, f, std::forward<T>(val));
+        }
+
+    private:
+        template <typename funcType, typename T>
+        static constexpr std::decay_t<std::result_of_t<const funcType&(T&&)>> impl(std::true_type, const funcType& f, T&& val) {
+            return f(std::forward<T>(val));
+        }
+
+        template <typename funcType, typename T>
+        static constexpr auto impl(std::false_type, const funcType& f, T&& val) {
+            return curry(f)(std::forward<T>(val));
+        }
+    };
+
+    // generic fmap via >>=
+    template <template <typename, typename...> class Monad, typename T, typename funcType, typename... Rest>
+    auto fmapImpl(std::false_type, funcType&& f, const Monad<T, Rest...>& x) {
         return x >>= ( [_f = curry(std::forward<funcType>(f))] (const T& val) {
             return  Monad<decltype(_f(std::declval<T>()))> {_f(val)}; });
     }
-    template <template <typename, typename...> class Monad, typename T, typename funcType>
-    auto fmap(funcType&& f, Monad<T>&& x) {
-        static_assert(is_monad<Monad>{}(), "");
+
+    template <template <typename, typename...> class Monad, typename T, typename funcType, typename... Rest>
+    auto fmapImpl(std::false_type, funcType&& f, Monad<T, Rest...>&& x) {
         return std::move(x) >>= ([ _f = curry(std::forward<funcType>(f))] (T&& val) {
             return Monad<decltype(_f(std::declval<T>()))> { _f(std::move(val)) }; });
     }
 
+    // fmap of a monad with a native_applicative instance
+    template <template <typename, typename...> class Monad, typename T, typename funcType, typename MonadT>
+    constexpr auto fmapImpl(std::true_type, funcType&& f, MonadT&& x) {
+        return native_applicative<Monad>::fmap(std::forward<funcType>(f), std::forward<MonadT>(x));
+    }
+
     template <template <typename, typename...> class Monad, typename T, typename funcType>
-    auto ap(const Monad<funcType>& wrappedFn, const Monad<T>& x) {
+    using has_native_fmap = std::integral_constant<bool, native_applicative<Monad>::value && is_callable<funcType&(const T&)>::value>;
+
+    // the further arguments Rest of Monad, e.g. an allocator, are handed
+    // through to the native instances
+    template <template <typename, typename...> class Monad, typename T, typename funcType, typename... Rest>
+    constexpr auto fmap(funcType&& f, const Monad<T, Rest...>& x) {
+        static_assert(is_monad<Monad>{}(), "expected type: Monad<T> for some monad type constructor 'Monad' and some type T \n actual type: ");
+        return fmapImpl<Monad, T>(has_native_fmap<Monad, T, funcType>{}, std::forward<funcType>(f), x);
+    }
+    template <template <typename, typename...> class Monad, typename T, typename funcType, typename... Rest>
+    constexpr auto fmap(funcType&& f, Monad<T, Rest...>&& x) {
+        static_assert(is_monad<Monad>{}(), "");
+        return fmapImpl<Monad, T>(has_native_fmap<Monad, T, funcType>{}, std::forward<funcType>(f), std::move(x));
+    }
+
+    template <template <typename, typename...> class Monad, typename T, typename funcType>
+    auto apImpl(std::false_type, const Monad<funcType>& wrappedFn, const Monad<T>& x) {
         return wrappedFn >>= [x] (auto&& x1) { return x >>= [x1 = curry(std::forward<decltype(x1)>(x1))] (auto&& x2) {
             return Monad<decltype(curry(std::declval<funcType>())(std::declval<T>()))> { x1 (std::forward<decltype(x2)>(x2)) }; }; };
     }
 
+    // pairs every function with every value directly, without copying x per
+    // function and without currying functions that take the value as is
+    template <template <typename, typename...> class Monad, typename T, typename funcType, typename... Rest1, typename... Rest2>
+    constexpr auto apImpl(std::true_type, const Monad<funcType, Rest1...>& wrappedFn, const Monad<T, Rest2...>& x) {
+        return native_applicative<Monad>::liftA2(apply_partially{}, wrappedFn, x);
+    }
+
+    template <template <typename, typename...> class Monad, typename T, typename funcType, typename... Rest1, typename... Rest2>
+    constexpr auto ap(const Monad<funcType, Rest1...>& wrappedFn, const Monad<T, Rest2...>& x) {
+        MONAD_COUNT(aps);
+        return apImpl(native_applicative<Monad>{}, wrappedFn, x);
+    }
+
     template <template <typename, typename...> class Monad, typename T>
-    Monad<std::remove_const_t<std::remove_reference_t<T>>> pure(T&& val) {
+    constexpr Monad<std::remove_const_t<std::remove_reference_t<T>>> pure(T&& val) {
         return Monad<std::remove_const_t<std::remove_reference_t<T>>> { std::forward<decltype(val)>(val) };
     }
 
+    // pure for allocator aware containers like std::list and std::vector,
+    // the result allocates with alloc
+    template <template <typename, typename...> class Monad, typename T, typename Alloc>
+    auto pure(T&& val, const Alloc& alloc) {
+        using value_t = std::remove_const_t<std::remove_reference_t<T>>;
+        using alloc_t = typename std::allocator_traits<Alloc>::template rebind_alloc<value_t>;
+        Monad<value_t, alloc_t> returnVal(alloc_t{alloc});
+        returnVal.push_back(std::forward<T>(val));
+        return returnVal;
+    }
+
+    template <template <typename, typename...> class Monad, typename funcType, typename T>
+    constexpr auto liftMImpl(std::false_type, const funcType& f, const T& x) {
+        return ap(pure<Monad>(f), x);
+    }
+
+    template <template <typename, typename...> class Monad, typename funcType, typename T>
+    constexpr auto liftMImpl(std::true_type, const funcType& f, const T& x) {
+        return native_applicative<Monad>::fmap(f, x);
+    }
+
+    template <template <typename, typename...> class Monad, typename funcType, typename T1, typename T2>
+    constexpr auto liftM2Impl(std::false_type, const funcType& f, const T1& x, const T2& y) {
+        return ap(ap(pure<Monad>(f), x), y);
+    }
+
+    template <template <typename, typename...> class Monad, typename funcType, typename T1, typename T2>
+    constexpr auto liftM2Impl(std::true_type, const funcType& f, const T1& x, const T2& y) {
+        return native_applicative<Monad>::liftA2(f, x, y);
+    }
+
+    // value type of a monadic value Monad<T, ...>
+    template <typename>
+    struct monadic_value;
+
+    template <template <typename, typename...> class Monad, typename T, typename... Rest>
+    struct monadic_value<Monad<T, Rest...>> : type_is<T> {};
+
+    template <typename T>
+    using monadic_value_t = typename monadic_value<T>::type;
+
+    // the functions returned by liftM and liftM2, named types instead of
+    // lambdas so that they can be called in constant expressions in C++14
+    template <template <typename, typename...> class Monad, typename funcType>
+    struct lifted_fn {
+        template <typename MonadT>
+        constexpr auto operator()(const MonadT& x) const {
+            using T = monadic_value_t<MonadT>;
+            return liftMImpl<Monad>(std::integral_constant<bool, native_applicative<Monad>::value
+                                        && is_callable<const funcType&(const T&)>::value>{}, _f, x);
+        }
+
+        funcType _f;
+    };
+
+    template <template <typename, typename...> class Monad, typename funcType>
+    struct lifted2_fn {
+        template <typename MonadT1, typename MonadT2>
+        constexpr auto operator()(const MonadT1& x, const MonadT2& y) const {
+            using T1 = monadic_value_t<MonadT1>;
+            using T2 = monadic_value_t<MonadT2>;
+            return liftM2Impl<Monad>(std::integral_constant<bool, native_applicative<Monad>::value
+                                         && is_callable<const funcType&(const T1&, const T2&)>::value>{}, _f, x, y);
+        }
+
+        funcType _f;
+    };
+
     template <template <typename, typename...> class Monad, typename funcType>
-    auto liftM(funcType&& f) {
-        return curry([_f = std::forward<decltype(f)>(f)] (auto x) {
-            return ap(pure<Monad>(_f), x);
-        });
+    constexpr auto liftM(funcType&& f) {
+        return curry(lifted_fn<Monad, std::decay_t<funcType>>{std::forward<funcType>(f)});
     }
 
     template <template <typename, typename...> class Monad, typename funcType>
-    auto liftM2(funcType&& f) {
-        return curry([_f = std::forward<decltype(f)>(f)] (auto x, auto y) {
-            return ap(ap(pure<Monad>(_f), x), y);
-        });
+    constexpr auto liftM2(funcType&& f) {
+        return curry(lifted2_fn<Monad, std::decay_t<funcType>>{std::forward<funcType>(f)});
+    }
+
+    // Monadic values that end every chain they are bound into, like an empty
+    // optional, have a member is_nothing(). The loops below stop as soon as
+    // they reach such a value instead of binding the remaining steps to it.
+    template <typename M, typename = void>
+    struct short_circuits : std::false_type {};
+
+    template <typename M>
+    struct short_circuits<M, void_t<decltype(std::declval<const M&>().is_nothing())>> : std::true_type {};
+
+    template <typename M>
+    bool is_stopped(const M& x, std::true_type) {
+        return x.is_nothing();
+    }
+
+    template <typename M>
+    bool is_stopped(const M&, std::false_type) {
+        return false;
+    }
+
+    // The loops keep a single monadic value and bind each step to it as an
+    // rvalue, so the value and the log of a Writer are moved instead of
+    // copied, and they run in constant stack space.
+
+    // folds xs from the left with a function f(acc, x) returning Monad<Acc>
+    template <typename funcType, typename Acc, typename Container>
+    auto foldM(funcType&& f, Acc&& init, const Container& xs) {
+        using result_t = std::decay_t<decltype(f(std::declval<std::decay_t<Acc>>(), *std::begin(xs)))>;
+        auto it = std::begin(xs);
+        const auto end = std::end(xs);
+        if (it == end) {
+            return result_t{std::forward<Acc>(init)};
+        }
+        result_t acc = f(std::forward<Acc>(init), *it);
+        // lazy monads like stream and asynchronous ones like Task call the
+        // steps after the loop moved on or after foldM returned, so the steps
+        // hold a copy of their element and share a copy of f
+        auto sharedF = std::make_shared<std::decay_t<funcType>>(std::forward<funcType>(f));
+        for (++it; it != end && !is_stopped(acc, short_circuits<result_t>{}); ++it) {
+            acc = std::move(acc) >>= [sharedF, elem = *it] (auto&& val) { return (*sharedF)(std::forward<decltype(val)>(val), elem); };
+        }
+        return acc;
+    }
+
+    // start >>= f >>= ... >>= f with n binds; f is passed to >>= as an
+    // lvalue, lazy and asynchronous monads store a copy of it
+    template <typename funcType, typename MonadT>
+    std::decay_t<MonadT> iterateM(std::size_t n, funcType&& f, MonadT&& start) {
+        std::decay_t<MonadT> acc = std::forward<MonadT>(start);
+        for (std::size_t i = 0; i < n && !is_stopped(acc, short_circuits<std::decay_t<MonadT>>{}); i++) {
+            acc = std::move(acc) >>= f;
+        }
+        return acc;
+    }
+
+    // the result of replicateM_ for n == 0, like Haskell's pure (): a
+    // value-initialized T without any effects, resp. the empty Monad<void>
+    template <typename MonadT, typename T, std::enable_if_t<std::is_void<T>::value, int> = 0>
+    MonadT noRuns() {
+        return MonadT{};
+    }
+
+    template <typename MonadT, typename T, std::enable_if_t<std::is_default_constructible<T>::value, int> = 0>
+    MonadT noRuns() {
+        return MonadT{T{}};
+    }
+
+    // there is no value to return without running x at least once
+    template <typename MonadT, typename T, std::enable_if_t<!std::is_void<T>::value && !std::is_default_constructible<T>::value, int> = 0>
+    MonadT noRuns() {
+        throw std::invalid_argument("replicateM_ with n == 0 needs a default constructible value type");
+    }
+
+    // x >> x >> ... >> x with n copies of x, i.e. runs x n times and keeps
+    // the effects of all runs and the value of the last one. For n == 0 the
+    // result has no effects and a value-initialized value, see noRuns.
+    template <template <typename, typename...> class Monad, typename T, typename... Rest>
+    Monad<T, Rest...> replicateM_(std::size_t n, const Monad<T, Rest...>& x) {
+        using MonadT = Monad<T, Rest...>;
+        if (n == 0) {
+            return noRuns<MonadT, T>();
+        }
+        MonadT acc = x;
+        // a copy of x, since lazy and asynchronous monads may call the step
+        // after replicateM_ returned
+        auto step = [x] (auto&&...) { return x; };
+        for (std::size_t i = 1; i < n && !is_stopped(acc, short_circuits<MonadT>{}); i++) {
+            acc = std::move(acc) >>= step;
+        }
+        return acc;
     }
 
 }
@@ -1,18 +1,61 @@
 #ifndef MONOID_H
 #define MONOID_H
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 #include "cpp17.h"
 
-// monoid instance for std::list
-template <typename T>
-std::list<T> operator+(const std::list<T>& l1, const std::list<T>& l2) {
-    std::list<T> returnList{l1};
+// monoid instance for std::list, the result keeps the allocator of l1 or,
+// if l1 is moved from, of the list that is reused
+template <typename T, typename A>
+std::list<T, A> operator+(const std::list<T, A>& l1, const std::list<T, A>& l2) {
+    std::list<T, A> returnList{l1};
     for (const auto& elem : l2) {
         returnList.push_back(elem);
     }
     return returnList;
 }
 
+template <typename T, typename A>
+std::list<T, A> operator+(std::list<T, A>&& l1, const std::list<T, A>& l2) {
+    l1.insert(l1.end(), l2.begin(), l2.end());
+    return std::move(l1);
+}
+
+template <typename T, typename A>
+std::list<T, A> operator+(const std::list<T, A>& l1, std::list<T, A>&& l2) {
+    l2.insert(l2.begin(), l1.begin(), l1.end());
+    return std::move(l2);
+}
+
+// nodes can only be spliced between lists with equal allocators
+template <typename T, typename A>
+std::list<T, A> operator+(std::list<T, A>&& l1, std::list<T, A>&& l2) {
+    if (l1.get_allocator() == l2.get_allocator()) {
+        l1.splice(l1.end(), l2);
+    } else {
+        l1.insert(l1.end(), std::make_move_iterator(l2.begin()), std::make_move_iterator(l2.end()));
+    }
+    return std::move(l1);
+}
+
+// materializes a monoid value into the form handed out by execWriter and
+// runWriter. This is the identity for every monoid except those with a
+// deferred representation like rope, which overload it.
+template <typename W>
+W materialize(const W& w) {
+    return w;
+}
+
+template <typename W, typename = std::enable_if_t<!std::is_lvalue_reference<W>::value>>
+W materialize(W&& w) {
+    return std::move(w);
+}
+
 namespace traits {
     template <typename T>
     using mappend_t = decltype(std::declval<T>() + std::declval<T>());
@@ -27,4 +70,82 @@ namespace traits {
     constexpr bool is_monoid_v = is_monoid<T>::value;
 } // namespace traits
 
+namespace detail {
+    // std::basic_string, whose + is plain concatenation, so the total size
+    // can be reserved up front and the operands appended in place. Other
+    // types, even if they have reserve and insert, go through their own +.
+    template <typename W>
+    struct is_reservable : std::false_type {};
+
+    template <typename Char, typename Traits, typename Alloc>
+    struct is_reservable<std::basic_string<Char, Traits, Alloc>> : std::true_type {};
+
+    template <typename W>
+    void appendTo(W& w, const W& other, std::false_type) {
+        w.insert(w.end(), other.begin(), other.end());
+    }
+
+    template <typename W>
+    void appendTo(W& w, W& other, std::true_type) {
+        w.insert(w.end(), std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+    }
+
+    // reserves the total size, then appends every operand once
+    template <typename Iterator>
+    auto mconcatImpl(Iterator first, Iterator last, std::true_type) {
+        std::decay_t<decltype(*first)> returnW{};
+        std::size_t totalSize = 0;
+        for (auto it = first; it != last; ++it) {
+            totalSize += (*it).size();
+        }
+        returnW.reserve(totalSize);
+        for (; first != last; ++first) {
+            auto&& w = *first;
+            appendTo(returnW, w, std::is_rvalue_reference<decltype(*first)>{});
+        }
+        return returnW;
+    }
+
+    // combines neighbours pairwise, level by level, so every operand takes
+    // part in O(log n) appends and each append gets two rvalues, e.g. two
+    // lists are spliced instead of copied
+    template <typename Iterator>
+    auto mconcatImpl(Iterator first, Iterator last, std::false_type) {
+        std::vector<std::decay_t<decltype(*first)>> parts(first, last);
+        if (parts.empty()) {
+            return std::decay_t<decltype(*first)>{};
+        }
+        for (std::size_t width = 1; width < parts.size(); width *= 2) {
+            for (std::size_t i = 0; i + width < parts.size(); i += 2 * width) {
+                parts[i] = std::move(parts[i]) + std::move(parts[i + width]);
+            }
+        }
+        return std::move(parts.front());
+    }
+} // namespace detail
+
+// The sum w1 + w2 + ... + wn of the monoid values in [first, last), and the
+// neutral element W{} for an empty range. Since + is associative the values
+// are combined in a balanced tree instead of from left to right, which for
+// the list + is linear instead of quadratic in n. Values are moved from if
+// the iterators yield rvalues, e.g. move_iterators or the overload for
+// rvalue ranges. std::basic_string values are instead appended to a single
+// string reserved to the total size, other monoids always use their own +.
+template <typename Iterator>
+auto mconcat(Iterator first, Iterator last) {
+    using monoid_t = std::decay_t<decltype(*first)>;
+    static_assert(traits::is_monoid_v<monoid_t>, "mconcat needs a monoid");
+    return detail::mconcatImpl(first, last, detail::is_reservable<monoid_t>{});
+}
+
+template <typename Range>
+auto mconcat(const Range& ws) {
+    return mconcat(std::begin(ws), std::end(ws));
+}
+
+template <typename Range, typename = std::enable_if_t<!std::is_lvalue_reference<Range>::value>>
+auto mconcat(Range&& ws) {
+    return mconcat(std::make_move_iterator(std::begin(ws)), std::make_move_iterator(std::end(ws)));
+}
+
 #endif
@@ -1,52 +1,256 @@
 #ifndef OPTIONAL_H
 #define OPTIONAL_H
+#include <memory>
+#include <new>
 #include <string>
 #include <type_traits>
 #include <stdexcept>
+#include <utility>
+#include "applicative.h"
+#include "instrument.h"
+
+// tag selecting the constructor that builds the value of an optional in place
+struct in_place_t {
+    explicit in_place_t() = default;
+};
+constexpr in_place_t in_place{};
+
+namespace detail {
+    // Storage of optional<T>. Trivially copyable T get a storage whose
+    // special members are all trivial, so optional<T> is trivially copyable
+    // as well; all other T get a storage that constructs and destroys the
+    // value explicitly.
+    template <typename T, bool = std::is_trivially_copyable<T>::value>
+    struct optional_storage {
+        constexpr optional_storage()
+            : _empty{}
+            , _nothing{true} {
+        }
+
+        template <typename... Args>
+        constexpr explicit optional_storage(in_place_t, Args&&... args)
+            : _val(std::forward<Args>(args)...)
+            , _nothing{false} {
+        }
+
+        template <typename... Args>
+        void construct(Args&&... args) {
+            ::new (static_cast<void*>(std::addressof(_val))) T(std::forward<Args>(args)...);
+            _nothing = false;
+        }
+
+        void reset() {
+            _nothing = true;
+        }
+
+        union {
+            char _empty;
+            T _val;
+        };
+        bool _nothing;
+    };
+
+    template <typename T>
+    struct optional_storage<T, false> {
+        optional_storage()
+            : _empty{}
+            , _nothing{true} {
+        }
+
+        template <typename... Args>
+        explicit optional_storage(in_place_t, Args&&... args)
+            : _val(std::forward<Args>(args)...)
+            , _nothing{false} {
+        }
+
+        optional_storage(const optional_storage& other)
+            : _empty{}
+            , _nothing{true} {
+            if (!other._nothing) {
+                construct(other._val);
+            }
+        }
+
+        optional_storage(optional_storage&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+            : _empty{}
+            , _nothing{true} {
+            if (!other._nothing) {
+                construct(std::move(other._val));
+            }
+        }
+
+        // assignment rebuilds the value so T doesn't need to be assignable
+        optional_storage& operator=(const optional_storage& other) {
+            if (this != &other) {
+                reset();
+                if (!other._nothing) {
+                    construct(other._val);
+                }
+            }
+            return *this;
+        }
+
+        optional_storage& operator=(optional_storage&& other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+            if (this != &other) {
+                reset();
+                if (!other._nothing) {
+                    construct(std::move(other._val));
+                }
+            }
+            return *this;
+        }
+
+        ~optional_storage() {
+            reset();
+        }
+
+        template <typename... Args>
+        void construct(Args&&... args) {
+            ::new (static_cast<void*>(std::addressof(_val))) T(std::forward<Args>(args)...);
+            _nothing = false;
+        }
+
+        void reset() {
+            if (!_nothing) {
+                _val.~T();
+                _nothing = true;
+            }
+        }
+
+        union {
+            char _empty;
+            T _val;
+        };
+        bool _nothing;
+    };
+} // namespace detail
 
 template <typename T>
-class optional {
+class optional : private detail::optional_storage<T> {
+    static_assert(!std::is_reference<T>::value, "optional of a reference type is not supported");
+
 public:
-    optional()
-        : _nothing(true) {};
+    optional() = default;
 
-    optional(T val)
-        : _nothing(false)
-        , _val{val} {
+    constexpr optional(const T& val)
+        : detail::optional_storage<T>(in_place, val) {
     }
 
-    bool is_nothing() const {
-        return _nothing;
+    constexpr optional(T&& val)
+        : detail::optional_storage<T>(in_place, std::move(val)) {
     }
 
-    T from_optional() const {
-        if (_nothing) {
-            throw std::runtime_error("Accessed empty optional");
+    template <typename... Args>
+    constexpr explicit optional(in_place_t, Args&&... args)
+        : detail::optional_storage<T>(in_place, std::forward<Args>(args)...) {
+    }
+
+    // destroys the current value, if any, and constructs a new one in place
+    template <typename... Args>
+    T& emplace(Args&&... args) {
+        this->reset();
+        this->construct(std::forward<Args>(args)...);
+        return this->_val;
+    }
+
+    constexpr bool is_nothing() const {
+        return this->_nothing;
+    }
+
+    // unchecked access, the optional must not be empty
+    constexpr T& operator*() & {
+        return this->_val;
+    }
+
+    constexpr const T& operator*() const& {
+        return this->_val;
+    }
+
+    constexpr T&& operator*() && {
+        return std::move(this->_val);
+    }
+
+    T* operator->() {
+        return std::addressof(this->_val);
+    }
+
+    const T* operator->() const {
+        return std::addressof(this->_val);
+    }
+
+    // checked access
+    constexpr T& from_optional() & {
+        checkNotEmpty();
+        return this->_val;
+    }
+
+    constexpr const T& from_optional() const& {
+        checkNotEmpty();
+        return this->_val;
+    }
+
+    constexpr T&& from_optional() && {
+        checkNotEmpty();
+        return std::move(this->_val);
+    }
+
+    template <typename funcType>
+    constexpr auto operator>>=(funcType&& f) const& {
+        MONAD_COUNT_LVALUE_BIND();
+        if (!is_nothing()) {
+            return f(**this);
+        } else {
+            return decltype(f(std::declval<const T&>())) {};
         }
-        return _val;
     }
 
+    // moves the value into f
     template <typename funcType>
-    auto operator>>=(funcType&& f) const {
+    constexpr auto operator>>=(funcType&& f) && {
+        MONAD_COUNT_RVALUE_BIND();
         if (!is_nothing()) {
-            return f(from_optional());
+            return f(std::move(this->_val));
         } else {
             return decltype(f(std::declval<T>())) {};
         }
     }
 
     std::string to_string() const {
-        if (_nothing) {
+        if (is_nothing()) {
             return "Nothing";
         } else {
-            return "Just " + std::to_string(_val);
+            return "Just " + std::to_string(this->_val);
         }
     }
 
 private:
-    bool _nothing = true;
-    union {
-        std::remove_reference_t<T> _val;
-    };
+    constexpr void checkNotEmpty() const {
+        if (is_nothing()) {
+            throw std::runtime_error("Accessed empty optional");
+        }
+    }
 };
+
+namespace monad {
+    template <>
+    struct native_applicative<optional> : std::true_type {
+        template <typename funcType, typename T>
+        static constexpr auto fmap(funcType&& f, const optional<T>& x) {
+            using result_t = optional<std::decay_t<decltype(f(std::declval<const T&>()))>>;
+            return x.is_nothing() ? result_t{} : result_t{f(*x)};
+        }
+
+        template <typename funcType, typename T>
+        static constexpr auto fmap(funcType&& f, optional<T>&& x) {
+            using result_t = optional<std::decay_t<decltype(f(std::declval<T>()))>>;
+            return x.is_nothing() ? result_t{} : result_t{f(*std::move(x))};
+        }
+
+        template <typename funcType, typename T1, typename T2>
+        static constexpr auto liftA2(funcType&& f, const optional<T1>& x, const optional<T2>& y) {
+            using result_t = optional<std::decay_t<decltype(f(std::declval<const T1&>(), std::declval<const T2&>()))>>;
+            return x.is_nothing() || y.is_nothing() ? result_t{} : result_t{f(*x, *y)};
+        }
+    };
+} // namespace monad
 #endif
@@ -0,0 +1,151 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "monoid.h"
+#include "thread_pool.h"
+#include "type_traits.h"
+
+namespace detail {
+    // concatenates the per-element results of par_bind in order, into a
+    // container with the allocator of the input like the sequential >>=
+    template <typename T, typename A, typename Alloc>
+    std::list<T, A> concat_results(std::vector<std::list<T, A>>& results, const Alloc& alloc) {
+        auto returnList = empty_with_allocator<std::list<T, A>>(alloc);
+        for (auto& result : results) {
+            if (returnList.get_allocator() == result.get_allocator()) {
+                returnList.splice(returnList.end(), result);
+            } else {
+                returnList.insert(returnList.end(), std::make_move_iterator(result.begin()), std::make_move_iterator(result.end()));
+            }
+        }
+        return returnList;
+    }
+
+    template <typename T, typename A, typename Alloc>
+    std::vector<T, A> concat_results(std::vector<std::vector<T, A>>& results, const Alloc& alloc) {
+        std::size_t totalSize = 0;
+        for (const auto& result : results) {
+            totalSize += result.size();
+        }
+        auto returnVec = empty_with_allocator<std::vector<T, A>>(alloc);
+        returnVec.reserve(totalSize);
+        for (auto& result : results) {
+            returnVec.insert(returnVec.end(), std::make_move_iterator(result.begin()), std::make_move_iterator(result.end()));
+        }
+        return returnVec;
+    }
+
+    // runs runChunk(0), ..., runChunk(chunkCount - 1) on the pool and the
+    // calling thread and rethrows the first exception thrown by a chunk
+    template <typename funcType>
+    void run_chunks(std::size_t chunkCount, thread_pool& pool, funcType&& runChunk) {
+        std::atomic<std::size_t> remaining{chunkCount};
+        std::exception_ptr error{};
+        std::mutex errorMutex{};
+        auto guardedChunk = [&] (std::size_t chunk) {
+            try {
+                runChunk(chunk);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            remaining.fetch_sub(1, std::memory_order_release);
+        };
+
+        for (std::size_t chunk = 1; chunk < chunkCount; chunk++) {
+            pool.submit([&guardedChunk, chunk] { guardedChunk(chunk); });
+        }
+        if (chunkCount > 0) {
+            guardedChunk(0);
+        }
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (!pool.run_pending_task()) {
+                std::this_thread::yield();
+            }
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    template <typename Iterator>
+    auto par_mconcat(Iterator first, Iterator last, thread_pool& pool) {
+        const std::size_t count = static_cast<std::size_t>(std::distance(first, last));
+        // one chunk per thread, the chunks are reduced with mconcat on their
+        // own and their sums once more at the end
+        const std::size_t chunkCount = std::max<std::size_t>(1, std::min(count, pool.size() + 1));
+        std::vector<Iterator> bounds{};
+        bounds.reserve(chunkCount + 1);
+        for (std::size_t chunk = 0; chunk < chunkCount; chunk++) {
+            bounds.push_back(first);
+            std::advance(first, count / chunkCount + (chunk < count % chunkCount ? 1 : 0));
+        }
+        bounds.push_back(first);
+
+        std::vector<std::decay_t<decltype(*first)>> sums(chunkCount);
+        run_chunks(chunkCount, pool, [&] (std::size_t chunk) {
+            sums[chunk] = mconcat(bounds[chunk], bounds[chunk + 1]);
+        });
+        return mconcat(std::move(sums));
+    }
+
+    template <typename Container, typename Result>
+    using is_par_bindable = std::integral_constant<bool,
+        (is_container<std::list, Container>{}() && is_container<std::list, Result>{}())
+        || (is_container<std::vector, Container>{}() && is_container<std::vector, Result>{}())>;
+} // namespace detail
+
+// Parallel version of the list and vector operator>>=: the calls f(elem) are
+// spread over the pool in chunks and their results are concatenated in the
+// order of xs, so the result equals xs >>= f. f is called concurrently and
+// must be safe to call from several threads at once. The calling thread
+// works on the chunks as well while it waits.
+template <typename Container, typename funcType>
+auto par_bind(const Container& xs, funcType&& f, thread_pool& pool = thread_pool::default_pool())
+    -> std::enable_if_t<detail::is_par_bindable<Container, decltype(f(*xs.begin()))>{}(), decltype(f(*xs.begin()))> {
+    std::vector<const typename Container::value_type*> elems{};
+    elems.reserve(xs.size());
+    for (const auto& elem : xs) {
+        elems.push_back(&elem);
+    }
+
+    std::vector<decltype(f(*xs.begin()))> results(elems.size());
+    // a few chunks per thread so stealing can even out uneven costs of f
+    const std::size_t chunkSize = std::max<std::size_t>(1, elems.size() / (4 * (pool.size() + 1)));
+    const std::size_t chunkCount = (elems.size() + chunkSize - 1) / chunkSize;
+
+    detail::run_chunks(chunkCount, pool, [&] (std::size_t chunk) {
+        const std::size_t last = std::min(elems.size(), (chunk + 1) * chunkSize);
+        for (std::size_t i = chunk * chunkSize; i < last; i++) {
+            results[i] = f(*elems[i]);
+        }
+    });
+    return detail::concat_results(results, xs.get_allocator());
+}
+
+// Parallel mconcat: the range is split into one slice per thread of the pool
+// (and the calling thread), the slices are summed concurrently and their sums
+// combined in order, which equals mconcat(ws) since + is associative. The
+// elements of an rvalue range are moved from.
+template <typename Range>
+auto par_mconcat(const Range& ws, thread_pool& pool = thread_pool::default_pool()) {
+    return detail::par_mconcat(std::begin(ws), std::end(ws), pool);
+}
+
+template <typename Range, typename = std::enable_if_t<!std::is_lvalue_reference<Range>::value>>
+auto par_mconcat(Range&& ws, thread_pool& pool = thread_pool::default_pool()) {
+    return detail::par_mconcat(std::make_move_iterator(std::begin(ws)), std::make_move_iterator(std::end(ws)), pool);
+}
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef ROPE_H
+#define ROPE_H
+#include <cstddef>
+#include <initializer_list>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// An immutable sequence with O(1) concatenation. A rope is a binary tree
+// whose leaves hold chunks of elements; appending two ropes only allocates a
+// new inner node that shares both operands, so a chain of N appends (e.g. the
+// log of N Writer binds) costs O(N) instead of the O(N^2) of std::list's
+// copying operator+. Copies are O(1) as well, since nodes are shared.
+//
+// The elements are only laid out as a flat sequence when materialize() is
+// called, which execWriter and runWriter do for the Writer log.
+template <typename T>
+class rope {
+public:
+    rope() = default;
+
+    rope(std::initializer_list<T> elems)
+        : rope(std::list<T>(elems)) {
+    }
+
+    rope(std::list<T> elems)
+        : _root{elems.empty() ? nullptr : std::make_shared<node>(std::move(elems))} {
+    }
+
+    std::size_t size() const {
+        return _root ? _root->size : 0;
+    }
+
+    bool empty() const {
+        return !_root;
+    }
+
+    std::list<T> to_list() const& {
+        std::list<T> returnList{};
+        for_each([&returnList] (const T& elem) { returnList.push_back(elem); });
+        return returnList;
+    }
+
+    // calls f on the elements in order
+    template <typename funcType>
+    void for_each(funcType&& f) const {
+        // in-order traversal with an explicit stack: ropes built by long bind
+        // chains are deeply left-nested and would overflow the call stack
+        std::vector<const node*> pending;
+        if (_root) {
+            pending.push_back(_root.get());
+        }
+        while (!pending.empty()) {
+            const node* current = pending.back();
+            pending.pop_back();
+            if (current->left) {
+                pending.push_back(current->right.get());
+                pending.push_back(current->left.get());
+            } else {
+                for (const auto& elem : current->elems) {
+                    f(elem);
+                }
+            }
+        }
+    }
+
+    // leaves that are owned by this rope alone are spliced into the result
+    // instead of being copied
+    std::list<T> to_list() && {
+        std::list<T> returnList{};
+        std::vector<std::pair<const node*, bool>> pending;
+        if (_root) {
+            pending.emplace_back(_root.get(), _root.use_count() == 1);
+        }
+        while (!pending.empty()) {
+            const node* current = pending.back().first;
+            bool owned = pending.back().second;
+            pending.pop_back();
+            if (current->left) {
+                pending.emplace_back(current->right.get(), owned && current->right.use_count() == 1);
+                pending.emplace_back(current->left.get(), owned && current->left.use_count() == 1);
+            } else if (owned) {
+                returnList.splice(returnList.end(), const_cast<node*>(current)->elems);
+            } else {
+                returnList.insert(returnList.end(), current->elems.begin(), current->elems.end());
+            }
+        }
+        _root.reset();
+        return returnList;
+    }
+
+    friend rope operator+(rope r1, rope r2) {
+        if (r1.empty()) {
+            return r2;
+        }
+        if (r2.empty()) {
+            return r1;
+        }
+        return rope(std::make_shared<node>(std::move(r1._root), std::move(r2._root)));
+    }
+
+private:
+    struct node;
+    using node_ptr = std::shared_ptr<const node>;
+
+    // a node is either a leaf holding elems or an inner node with two
+    // non-null children
+    struct node {
+        node(std::list<T> leafElems)
+            : elems{std::move(leafElems)}
+            , size{elems.size()} {
+        }
+
+        node(node_ptr l, node_ptr r)
+            : left{std::move(l)}
+            , right{std::move(r)}
+            , size{left->size + right->size} {
+        }
+
+        // releases uniquely owned descendants iteratively for the same reason
+        // to_list doesn't recurse
+        ~node() {
+            if (!(left && left.use_count() == 1) && !(right && right.use_count() == 1)) {
+                return;
+            }
+            std::vector<node_ptr> orphans;
+            orphans.push_back(std::move(left));
+            orphans.push_back(std::move(right));
+            while (!orphans.empty()) {
+                node_ptr current = std::move(orphans.back());
+                orphans.pop_back();
+                if (current && current.use_count() == 1) {
+                    node& owned = const_cast<node&>(*current);
+                    orphans.push_back(std::move(owned.left));
+                    orphans.push_back(std::move(owned.right));
+                }
+            }
+        }
+
+        std::list<T> elems;
+        node_ptr left;
+        node_ptr right;
+        std::size_t size;
+    };
+
+    explicit rope(node_ptr root)
+        : _root{std::move(root)} {
+    }
+
+    node_ptr _root;
+};
+
+template <typename T>
+std::list<T> materialize(const rope<T>& r) {
+    return r.to_list();
+}
+
+template <typename T>
+std::list<T> materialize(rope<T>&& r) {
+    return std::move(r).to_list();
+}
+
+#endif
@@ -0,0 +1,294 @@
+#ifndef SIMD_H
+#define SIMD_H
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include "cpp17.h"
+#include "type_traits.h"
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Vectorized kernels for fmap and liftA2 over contiguous numeric containers
+// (see the native_applicative instance in vector.h).
+//
+// The arithmetic functors std::plus, std::minus, std::multiplies and
+// std::negate (both the transparent and the typed form) are recognized on
+// float, double and int32_t and run on AVX2 or SSE2 registers, whichever the
+// target supports, with a scalar loop as fallback. Negation flips the sign
+// bit of floating point numbers like the scalar -x, also of 0.0 and NaN.
+//
+// Other elementwise functions can be marked with simd_safe(f), which
+// promises that f is a pure function of its arguments, so it is called in a
+// tight loop without aliasing that the compiler may vectorize:
+//
+//     auto square = simd_safe([] (float x) { return x * x; });
+//     auto squared = monad::fmap(square, xs);
+//
+// liftA2 pairs every x with every y; it broadcasts one x into a register and
+// combines it with a block of ys at a time.
+
+template <typename funcType>
+struct simd_safe_fn {
+    funcType f;
+
+    template <typename... Args>
+    auto operator()(Args&&... args) const -> decltype(f(std::forward<Args>(args)...)) {
+        return f(std::forward<Args>(args)...);
+    }
+};
+
+template <typename funcType>
+simd_safe_fn<std::decay_t<funcType>> simd_safe(funcType&& f) {
+    return simd_safe_fn<std::decay_t<funcType>>{std::forward<funcType>(f)};
+}
+
+namespace simd {
+    // the register type of T for the target, not defined if there is none
+    template <typename T>
+    struct pack;
+
+#if defined(__AVX2__)
+    template <>
+    struct pack<float> {
+        using type = __m256;
+        static constexpr std::size_t width = 8;
+        static type load(const float* ptr) { return _mm256_loadu_ps(ptr); }
+        static void store(float* ptr, type x) { _mm256_storeu_ps(ptr, x); }
+        static type broadcast(float x) { return _mm256_set1_ps(x); }
+        static type add(type x, type y) { return _mm256_add_ps(x, y); }
+        static type sub(type x, type y) { return _mm256_sub_ps(x, y); }
+        static type mul(type x, type y) { return _mm256_mul_ps(x, y); }
+        static type neg(type x) { return _mm256_xor_ps(x, _mm256_set1_ps(-0.0f)); }
+    };
+
+    template <>
+    struct pack<double> {
+        using type = __m256d;
+        static constexpr std::size_t width = 4;
+        static type load(const double* ptr) { return _mm256_loadu_pd(ptr); }
+        static void store(double* ptr, type x) { _mm256_storeu_pd(ptr, x); }
+        static type broadcast(double x) { return _mm256_set1_pd(x); }
+        static type add(type x, type y) { return _mm256_add_pd(x, y); }
+        static type sub(type x, type y) { return _mm256_sub_pd(x, y); }
+        static type mul(type x, type y) { return _mm256_mul_pd(x, y); }
+        static type neg(type x) { return _mm256_xor_pd(x, _mm256_set1_pd(-0.0)); }
+    };
+
+    template <>
+    struct pack<std::int32_t> {
+        using type = __m256i;
+        static constexpr std::size_t width = 8;
+        static type load(const std::int32_t* ptr) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)); }
+        static void store(std::int32_t* ptr, type x) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(ptr), x); }
+        static type broadcast(std::int32_t x) { return _mm256_set1_epi32(x); }
+        static type add(type x, type y) { return _mm256_add_epi32(x, y); }
+        static type sub(type x, type y) { return _mm256_sub_epi32(x, y); }
+        static type mul(type x, type y) { return _mm256_mullo_epi32(x, y); }
+        static type neg(type x) { return _mm256_sub_epi32(_mm256_setzero_si256(), x); }
+    };
+#elif defined(__SSE2__)
+    template <>
+    struct pack<float> {
+        using type = __m128;
+        static constexpr std::size_t width = 4;
+        static type load(const float* ptr) { return _mm_loadu_ps(ptr); }
+        static void store(float* ptr, type x) { _mm_storeu_ps(ptr, x); }
+        static type broadcast(float x) { return _mm_set1_ps(x); }
+        static type add(type x, type y) { return _mm_add_ps(x, y); }
+        static type sub(type x, type y) { return _mm_sub_ps(x, y); }
+        static type mul(type x, type y) { return _mm_mul_ps(x, y); }
+        static type neg(type x) { return _mm_xor_ps(x, _mm_set1_ps(-0.0f)); }
+    };
+
+    template <>
+    struct pack<double> {
+        using type = __m128d;
+        static constexpr std::size_t width = 2;
+        static type load(const double* ptr) { return _mm_loadu_pd(ptr); }
+        static void store(double* ptr, type x) { _mm_storeu_pd(ptr, x); }
+        static type broadcast(double x) { return _mm_set1_pd(x); }
+        static type add(type x, type y) { return _mm_add_pd(x, y); }
+        static type sub(type x, type y) { return _mm_sub_pd(x, y); }
+        static type mul(type x, type y) { return _mm_mul_pd(x, y); }
+        static type neg(type x) { return _mm_xor_pd(x, _mm_set1_pd(-0.0)); }
+    };
+    // SSE2 has no 32 bit integer multiplication, so there is no pack for
+    // int32_t and all its operations use the scalar loops
+#endif
+
+    template <typename T, typename = void>
+    struct has_pack : std::false_type {};
+
+    template <typename T>
+    struct has_pack<T, void_t<decltype(pack<T>::width)>> : std::true_type {};
+
+    // the operations behind the recognized functors
+    struct add_op {
+        template <typename P, typename V>
+        static V vector(V x, V y) { return P::add(x, y); }
+        template <typename T>
+        static T scalar(T x, T y) { return x + y; }
+    };
+
+    struct sub_op {
+        template <typename P, typename V>
+        static V vector(V x, V y) { return P::sub(x, y); }
+        template <typename T>
+        static T scalar(T x, T y) { return x - y; }
+    };
+
+    struct mul_op {
+        template <typename P, typename V>
+        static V vector(V x, V y) { return P::mul(x, y); }
+        template <typename T>
+        static T scalar(T x, T y) { return x * y; }
+    };
+
+    struct neg_op {
+        template <typename P, typename V>
+        static V vector(V x) { return P::neg(x); }
+        template <typename T>
+        static T scalar(T x) { return -x; }
+    };
+
+    // maps a functor applied to elements of type T to its operation
+    template <typename funcType, typename T>
+    struct binary_op {
+        using type = void;
+    };
+
+    template <typename T> struct binary_op<std::plus<>, T> : type_is<add_op> {};
+    template <typename T> struct binary_op<std::plus<T>, T> : type_is<add_op> {};
+    template <typename T> struct binary_op<std::minus<>, T> : type_is<sub_op> {};
+    template <typename T> struct binary_op<std::minus<T>, T> : type_is<sub_op> {};
+    template <typename T> struct binary_op<std::multiplies<>, T> : type_is<mul_op> {};
+    template <typename T> struct binary_op<std::multiplies<T>, T> : type_is<mul_op> {};
+
+    template <typename funcType, typename T>
+    struct unary_op {
+        using type = void;
+    };
+
+    template <typename T> struct unary_op<std::negate<>, T> : type_is<neg_op> {};
+    template <typename T> struct unary_op<std::negate<T>, T> : type_is<neg_op> {};
+
+    template <typename T>
+    using is_simd_element = std::integral_constant<bool,
+        std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, std::int32_t>::value>;
+
+    template <typename funcType, typename T>
+    using is_known_unary = std::integral_constant<bool, is_simd_element<T>::value
+        && !std::is_void<typename unary_op<std::decay_t<funcType>, T>::type>::value>;
+
+    template <typename funcType, typename T1, typename T2>
+    using is_known_binary = std::integral_constant<bool, is_simd_element<T1>::value && std::is_same<T1, T2>::value
+        && !std::is_void<typename binary_op<std::decay_t<funcType>, T1>::type>::value>;
+
+    template <typename>
+    struct is_simd_safe : std::false_type {};
+
+    template <typename funcType>
+    struct is_simd_safe<simd_safe_fn<funcType>> : std::true_type {};
+
+    // arithmetic types other than bool, which std::vector packs into bits
+    template <typename T>
+    using is_number = std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>;
+
+    // whether fmap(f, x) resp. liftA2(f, x, y) over contiguous Ts run here
+    template <typename funcType, typename T, typename R>
+    using is_vectorizable_unary = std::integral_constant<bool, is_known_unary<funcType, T>::value
+        || (is_simd_safe<std::decay_t<funcType>>::value && is_number<T>::value && is_number<R>::value)>;
+
+    template <typename funcType, typename T1, typename T2, typename R>
+    using is_vectorizable_binary = std::integral_constant<bool, is_known_binary<funcType, T1, T2>::value
+        || (is_simd_safe<std::decay_t<funcType>>::value && is_number<T1>::value && is_number<T2>::value && is_number<R>::value)>;
+
+    // out[i] = op(in[i])
+    template <typename Op, typename T>
+    void map_op(Op, const T* in, T* out, std::size_t n, std::true_type) {
+        using P = pack<T>;
+        std::size_t i = 0;
+        for (; i + P::width <= n; i += P::width) {
+            P::store(out + i, Op::template vector<P>(P::load(in + i)));
+        }
+        for (; i < n; i++) {
+            out[i] = Op::scalar(in[i]);
+        }
+    }
+
+    template <typename Op, typename T>
+    void map_op(Op, const T* in, T* out, std::size_t n, std::false_type) {
+        for (std::size_t i = 0; i < n; i++) {
+            out[i] = Op::scalar(in[i]);
+        }
+    }
+
+    // out[j] = op(x, ys[j])
+    template <typename Op, typename T>
+    void broadcast_left(Op, T x, const T* ys, T* out, std::size_t n, std::true_type) {
+        using P = pack<T>;
+        const auto xs = P::broadcast(x);
+        std::size_t j = 0;
+        for (; j + P::width <= n; j += P::width) {
+            P::store(out + j, Op::template vector<P>(xs, P::load(ys + j)));
+        }
+        for (; j < n; j++) {
+            out[j] = Op::scalar(x, ys[j]);
+        }
+    }
+
+    template <typename Op, typename T>
+    void broadcast_left(Op, T x, const T* ys, T* out, std::size_t n, std::false_type) {
+        for (std::size_t j = 0; j < n; j++) {
+            out[j] = Op::scalar(x, ys[j]);
+        }
+    }
+
+    // out[i] = f(in[i]) for recognized functors and simd_safe functions
+    template <typename funcType, typename T, typename R>
+    void map(const funcType&, const T* in, R* out, std::size_t n, std::true_type) {
+        map_op(typename unary_op<funcType, T>::type{}, in, out, n, has_pack<T>{});
+    }
+
+    template <typename funcType, typename T, typename R>
+    void map(const simd_safe_fn<funcType>& f, const T* __restrict in, R* __restrict out, std::size_t n, std::false_type) {
+        for (std::size_t i = 0; i < n; i++) {
+            out[i] = f.f(in[i]);
+        }
+    }
+
+    template <typename funcType, typename T, typename R>
+    void map(const funcType& f, const T* in, R* out, std::size_t n) {
+        map(f, in, out, n, is_known_unary<funcType, T>{});
+    }
+
+    // out[i * ny + j] = f(xs[i], ys[j])
+    template <typename funcType, typename T1, typename T2, typename R>
+    void cartesian(const funcType&, const T1* xs, std::size_t nx, const T2* ys, std::size_t ny, R* out, std::true_type) {
+        for (std::size_t i = 0; i < nx; i++) {
+            broadcast_left(typename binary_op<funcType, T1>::type{}, xs[i], ys, out + i * ny, ny, has_pack<T1>{});
+        }
+    }
+
+    template <typename funcType, typename T1, typename T2, typename R>
+    void cartesian(const simd_safe_fn<funcType>& f, const T1* __restrict xs, std::size_t nx,
+                   const T2* __restrict ys, std::size_t ny, R* __restrict out, std::false_type) {
+        for (std::size_t i = 0; i < nx; i++) {
+            const T1 x = xs[i];
+            R* __restrict row = out + i * ny;
+            for (std::size_t j = 0; j < ny; j++) {
+                row[j] = f.f(x, ys[j]);
+            }
+        }
+    }
+
+    template <typename funcType, typename T1, typename T2, typename R>
+    void cartesian(const funcType& f, const T1* xs, std::size_t nx, const T2* ys, std::size_t ny, R* out) {
+        cartesian(f, xs, nx, ys, ny, out, is_known_binary<funcType, T1, T2>{});
+    }
+} // namespace simd
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef STREAM_H
+#define STREAM_H
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "type_traits.h"
+
+// A lazy, pull-based sequence. A stream only describes how to produce its
+// elements; nothing is computed until it is iterated or collected with
+// to_list()/to_vector(). Binding a stream produces a stream again, so a
+// chain of >>= (and hence fmap, ap, join and liftM2) runs as one fused pass
+// that holds a single element per stage instead of a container per stage.
+//
+// Streams are cheap to copy and can be iterated any number of times; every
+// iteration starts a fresh cursor and recomputes the elements.
+template <typename T>
+class stream {
+public:
+    using value_type = T;
+    // yields a pointer to the next element, which stays valid until the
+    // following call, or nullptr once the stream is exhausted
+    using cursor = std::function<const T*()>;
+    // starts a new pass over the stream
+    using source = std::function<cursor()>;
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator() = default;
+
+        explicit iterator(cursor c)
+            : _cursor{std::make_shared<cursor>(std::move(c))}
+            , _current{(*_cursor)()} {
+        }
+
+        const T& operator*() const {
+            return *_current;
+        }
+
+        const T* operator->() const {
+            return _current;
+        }
+
+        iterator& operator++() {
+            _current = (*_cursor)();
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator previous{*this};
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const iterator& other) const {
+            return _current == other._current;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        std::shared_ptr<cursor> _cursor;
+        const T* _current = nullptr;
+    };
+
+    stream() = default;
+
+    explicit stream(source src)
+        : _source{std::move(src)} {
+    }
+
+    stream(std::initializer_list<T> elems) {
+        if (elems.size() == 1) {
+            // singletons are what pure and fmap produce for every element,
+            // so they avoid the shared container
+            T val{*elems.begin()};
+            _source = [val] {
+                return cursor([val, done = false] () mutable -> const T* {
+                    if (done) {
+                        return nullptr;
+                    }
+                    done = true;
+                    return &val;
+                });
+            };
+        } else if (elems.size() > 1) {
+            *this = make(std::vector<T>(elems));
+        }
+    }
+
+    // a stream over the elements of an existing container, which is kept
+    // alive by the stream
+    template <typename Container>
+    static stream make(Container elems) {
+        auto shared = std::make_shared<const Container>(std::move(elems));
+        return stream([shared] {
+            return cursor([shared, it = shared->begin()] () mutable -> const T* {
+                if (it == shared->end()) {
+                    return nullptr;
+                }
+                return &*it++;
+            });
+        });
+    }
+
+    cursor start() const {
+        if (!_source) {
+            return [] () -> const T* { return nullptr; };
+        }
+        return _source();
+    }
+
+    iterator begin() const {
+        return iterator{start()};
+    }
+
+    iterator end() const {
+        return iterator{};
+    }
+
+    std::list<T> to_list() const {
+        return std::list<T>(begin(), end());
+    }
+
+    std::vector<T> to_vector() const {
+        return std::vector<T>(begin(), end());
+    }
+
+    template <typename funcType>
+    auto operator>>=(funcType&& f) const&
+        -> std::enable_if_t<is_container<stream, decltype(f(std::declval<const T&>()))>{}(), decltype(f(std::declval<const T&>()))> {
+        using result_t = decltype(f(std::declval<const T&>()));
+        using result_cursor = typename result_t::cursor;
+        using U = typename result_t::value_type;
+        auto outerSource = *this;
+        return result_t([outerSource, f = std::decay_t<funcType>(std::forward<funcType>(f))] {
+            return result_cursor([outer = outerSource.start(), inner = result_cursor{}, f] () mutable -> const U* {
+                while (true) {
+                    if (inner) {
+                        if (const U* elem = inner()) {
+                            return elem;
+                        }
+                        inner = nullptr;
+                    }
+                    const T* elem = outer();
+                    if (!elem) {
+                        return nullptr;
+                    }
+                    inner = f(*elem).start();
+                }
+            });
+        });
+    }
+
+    // the elements are shared by the copies of a stream and recomputed by
+    // every pass, so f gets a copy of each element to move from
+    template <typename funcType>
+    auto operator>>=(funcType&& f) &&
+        -> std::enable_if_t<is_container<stream, decltype(f(std::declval<T>()))>{}(), decltype(f(std::declval<T>()))> {
+        return *this >>= [f = std::decay_t<funcType>(std::forward<funcType>(f))] (const T& elem) mutable {
+            return f(T(elem));
+        };
+    }
+
+private:
+    source _source;
+};
+
+template <typename Container>
+auto make_stream(Container&& elems) {
+    return stream<typename std::decay_t<Container>::value_type>::make(std::forward<Container>(elems));
+}
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef TASK_H
+#define TASK_H
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "applicative.h"
+#include "optional.h"
+#include "thread_pool.h"
+#include "type_traits.h"
+
+template <typename T>
+class Task;
+
+namespace detail {
+    // The state shared by all copies of a Task: the value or the exception
+    // once the computation finished and the continuations waiting for it.
+    template <typename T>
+    class task_state {
+    public:
+        explicit task_state(thread_pool& pool)
+            : _pool{&pool}
+            , _ready{false} {
+        }
+
+        template <typename... Args>
+        void set_value(Args&&... args) {
+            std::vector<std::function<void()>> continuations{};
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _value.emplace(std::forward<Args>(args)...);
+                _ready.store(true, std::memory_order_release);
+                continuations.swap(_continuations);
+            }
+            schedule(continuations);
+        }
+
+        void set_error(std::exception_ptr error) {
+            std::vector<std::function<void()>> continuations{};
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _error = error;
+                _ready.store(true, std::memory_order_release);
+                continuations.swap(_continuations);
+            }
+            schedule(continuations);
+        }
+
+        // submits continuation to the pool as soon as the state is ready
+        void on_ready(std::function<void()> continuation) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (!_ready.load(std::memory_order_relaxed)) {
+                    _continuations.push_back(std::move(continuation));
+                    return;
+                }
+            }
+            _pool->submit(std::move(continuation));
+        }
+
+        bool is_ready() const {
+            return _ready.load(std::memory_order_acquire);
+        }
+
+        // only valid once the state is ready
+        const T& value() const {
+            if (_error) {
+                std::rethrow_exception(_error);
+            }
+            return *_value;
+        }
+
+        std::exception_ptr error() const {
+            return _error;
+        }
+
+        thread_pool& pool() const {
+            return *_pool;
+        }
+
+    private:
+        void schedule(std::vector<std::function<void()>>& continuations) {
+            for (auto& continuation : continuations) {
+                _pool->submit(std::move(continuation));
+            }
+        }
+
+        thread_pool* _pool;
+        std::mutex _mutex;
+        std::atomic<bool> _ready;
+        optional<T> _value;
+        std::exception_ptr _error;
+        std::vector<std::function<void()>> _continuations;
+    };
+
+    // calls f with args and stores the result or the exception in state
+    template <typename T, typename funcType, typename... Args>
+    void complete_with(task_state<T>& state, funcType& f, const Args&... args) {
+        try {
+            state.set_value(f(args...));
+        } catch (...) {
+            state.set_error(std::current_exception());
+        }
+    }
+} // namespace detail
+
+// An asynchronous computation running on a thread_pool. Tasks are started
+// when they are created and copies share the result, like std::shared_future.
+//
+// Binding with >>= never blocks a thread: the function is scheduled on the
+// pool once the value is available. Exceptions propagate through the chain
+// and are rethrown by get().
+template <typename T>
+class Task {
+public:
+    // a task that is ready with val, this makes pure<Task> work
+    Task(T val, thread_pool& pool = thread_pool::default_pool())
+        : _state{std::make_shared<detail::task_state<T>>(pool)} {
+        _state->set_value(std::move(val));
+    }
+
+    explicit Task(std::shared_ptr<detail::task_state<T>> state)
+        : _state{std::move(state)} {
+    }
+
+    bool is_ready() const {
+        return _state->is_ready();
+    }
+
+    // waits for the result; the calling thread runs other tasks of the pool
+    // while it waits, so get() may be called from within a task as well
+    const T& get() const {
+        while (!_state->is_ready()) {
+            if (!_state->pool().run_pending_task()) {
+                std::this_thread::yield();
+            }
+        }
+        return _state->value();
+    }
+
+    thread_pool& pool() const {
+        return _state->pool();
+    }
+
+    // submits continuation to the pool once the task finished, either with
+    // a value or with an exception
+    void on_ready(std::function<void()> continuation) const {
+        _state->on_ready(std::move(continuation));
+    }
+
+    template <typename funcType>
+    auto operator>>=(funcType f) const
+        -> std::enable_if_t<is_container<Task, decltype(f(std::declval<const T&>()))>{}(), decltype(f(std::declval<const T&>()))> {
+        using result_t = typename decltype(f(std::declval<const T&>()))::value_type;
+        auto result = std::make_shared<detail::task_state<result_t>>(pool());
+        auto state = _state;
+        _state->on_ready([state, result, f] {
+            if (state->error()) {
+                result->set_error(state->error());
+                return;
+            }
+            try {
+                auto inner = f(state->value());
+                auto innerState = inner._state;
+                innerState->on_ready([innerState, result] {
+                    if (innerState->error()) {
+                        result->set_error(innerState->error());
+                    } else {
+                        result->set_value(innerState->value());
+                    }
+                });
+            } catch (...) {
+                result->set_error(std::current_exception());
+            }
+        });
+        return Task<result_t>{result};
+    }
+
+    using value_type = T;
+
+private:
+    template <typename>
+    friend class Task;
+    friend struct ::monad::native_applicative<Task>;
+
+    std::shared_ptr<detail::task_state<T>> _state;
+};
+
+// runs f() on the pool and returns the task of its result
+template <typename funcType>
+auto spawn(funcType f, thread_pool& pool = thread_pool::default_pool()) {
+    using result_t = std::decay_t<decltype(f())>;
+    auto state = std::make_shared<detail::task_state<result_t>>(pool);
+    pool.submit([state, f] () mutable { detail::complete_with(*state, f); });
+    return Task<result_t>{state};
+}
+
+namespace monad {
+    // fmap and liftA2 call f directly once their operands are ready. Both
+    // operands of liftA2 run concurrently and whichever finishes last
+    // schedules f, so independent computations combined with ap or liftM2
+    // overlap instead of running one after another.
+    template <>
+    struct native_applicative<Task> : std::true_type {
+        template <typename funcType, typename T>
+        static auto fmap(funcType f, const Task<T>& x) {
+            using result_t = std::decay_t<decltype(f(std::declval<const T&>()))>;
+            auto result = std::make_shared<detail::task_state<result_t>>(x.pool());
+            auto state = x._state;
+            state->on_ready([state, result, f] () mutable {
+                if (state->error()) {
+                    result->set_error(state->error());
+                } else {
+                    detail::complete_with(*result, f, state->value());
+                }
+            });
+            return Task<result_t>{result};
+        }
+
+        template <typename funcType, typename T1, typename T2>
+        static auto liftA2(funcType f, const Task<T1>& x, const Task<T2>& y) {
+            using result_t = std::decay_t<decltype(f(std::declval<const T1&>(), std::declval<const T2&>()))>;
+            auto result = std::make_shared<detail::task_state<result_t>>(x.pool());
+            auto xState = x._state;
+            auto yState = y._state;
+            auto remaining = std::make_shared<std::atomic<int>>(2);
+            auto combine = [xState, yState, result, remaining, f] () mutable {
+                if (remaining->fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                    return;
+                }
+                if (xState->error()) {
+                    result->set_error(xState->error());
+                } else if (yState->error()) {
+                    result->set_error(yState->error());
+                } else {
+                    detail::complete_with(*result, f, xState->value(), yState->value());
+                }
+            };
+            xState->on_ready(combine);
+            yState->on_ready(combine);
+            return Task<result_t>{result};
+        }
+    };
+} // namespace monad
+#endif
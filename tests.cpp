@@ -0,0 +1,543 @@
+// Runtime checks for the monad primitives, kept apart from the exercises in
+// ex01.cpp.
+//
+// Build and run with e.g.
+//     g++ -std=c++14 -pthread tests.cpp -o tests && ./tests
+//
+// Every failed check is printed with its line number and the program exits
+// with a non-zero status if any check failed.
+#include "arena.h"
+#include "concurrent_log.h"
+#include "curry.h"
+#include "fixed_seq.h"
+#include "instrument.h"
+#include "list.h"
+#include "memoize.h"
+#include "log_sink.h"
+#include "vector.h"
+#include "function.h"
+#include "monad.h"
+#include "monoid.h"
+#include "optional.h"
+#include "parallel.h"
+#include "rope.h"
+#include "stream.h"
+#include "task.h"
+#include "writer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char* text, int line) {
+        if (!condition) {
+            std::printf("tests.cpp:%d: check failed: %s\n", line, text);
+            failures++;
+        }
+    }
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+    // ropes keep the order of their appends, share their nodes between
+    // copies and are destroyed without recursion
+    void testRope() {
+        rope<int> left = rope<int>{1, 2} + rope<int>{3};
+        rope<int> both = left + (rope<int>{} + rope<int>{4, 5});
+        CHECK(both.size() == 5);
+        CHECK(materialize(both) == (std::list<int>{1, 2, 3, 4, 5}));
+
+        // moving out of a rope must not change copies sharing its nodes
+        rope<int> copy = both;
+        CHECK(materialize(std::move(both)) == (std::list<int>{1, 2, 3, 4, 5}));
+        CHECK(materialize(copy) == (std::list<int>{1, 2, 3, 4, 5}));
+        CHECK(materialize(left) == (std::list<int>{1, 2, 3}));
+
+        // a long bind chain builds a deeply left-nested rope, destroying it
+        // recursively would overflow the stack
+        rope<std::string> deep{};
+        for (int i = 0; i < 1000000; i++) {
+            deep = std::move(deep) + rope<std::string>{"step"};
+        }
+        CHECK(deep.size() == 1000000);
+        rope<std::string> shared = deep;
+        deep = rope<std::string>{};
+        CHECK(shared.size() == 1000000 && materialize(shared).size() == 1000000);
+    }
+
+    // counts its copies and moves, it's used both as the value and as the
+    // log (a monoid summing n) of Writers
+    struct counted {
+        static int copies;
+        static int moves;
+
+        counted(int n = 0)
+            : n{n} {
+        }
+
+        counted(const counted& other)
+            : n{other.n} {
+            copies++;
+        }
+
+        counted(counted&& other) noexcept
+            : n{other.n} {
+            moves++;
+        }
+
+        counted& operator=(const counted& other) {
+            n = other.n;
+            copies++;
+            return *this;
+        }
+
+        counted& operator=(counted&& other) noexcept {
+            n = other.n;
+            moves++;
+            return *this;
+        }
+
+        friend counted operator+(counted c1, const counted& c2) {
+            c1.n += c2.n;
+            return c1;
+        }
+
+        int n;
+    };
+
+    int counted::copies = 0;
+    int counted::moves = 0;
+
+    // binding temporaries moves the value and the log from step to step
+    // instead of copying them
+    void testWriterRvalueBinds() {
+        using monad::Writer::writer;
+        auto countStep = [] (counted x) { return writer(counted{x.n + 1}, counted{1}); };
+        counted::copies = 0;
+        counted::moves = 0;
+        auto counting = monad::Writer::runWriter(((writer(counted{0}, counted{0}) >>= countStep) >>= countStep) >>= countStep);
+        CHECK(counting.first.n == 3);
+        CHECK(counting.second.n == 3);
+        CHECK(counted::copies == 0);
+        CHECK(counted::moves > 0);
+    }
+
+    // fmap with std::negate runs on SIMD registers (see simd.h) and has to
+    // flip the sign of zeros and NaNs like the scalar -x does; 9 elements
+    // cover the vector lanes and the scalar tail
+    void testNegateVector() {
+        auto negateVector = [] (const auto& xs) { return monad::fmap(std::negate<>{}, xs); };
+        auto allNegative = [] (const auto& xs) {
+            return std::all_of(xs.begin(), xs.end(), [] (auto x) { return std::signbit(x); });
+        };
+        auto allPositive = [] (const auto& xs) {
+            return std::none_of(xs.begin(), xs.end(), [] (auto x) { return std::signbit(x); });
+        };
+        CHECK(allNegative(negateVector(std::vector<float>(9, 0.0f))));
+        CHECK(allPositive(negateVector(std::vector<double>(5, -0.0))));
+        CHECK(allNegative(negateVector(std::vector<float>(9, std::numeric_limits<float>::quiet_NaN()))));
+        CHECK(negateVector(std::vector<int>{1, -2, 3, 0, 5, -6, 7, 8, 9}) == (std::vector<int>{-1, 2, -3, 0, -5, 6, -7, -8, -9}));
+    }
+
+    // par_bind returns exactly what the sequential >>= returns, also with a
+    // single thread, nested in f and with more chunks than threads
+    void testParBind() {
+        thread_pool pool(3);
+        thread_pool single(1);
+        std::vector<int> xs{};
+        std::list<int> ls{};
+        for (int i = 0; i < 10000; i++) {
+            xs.push_back(i);
+            ls.push_back(i);
+        }
+        auto repeatVector = [] (int x) { return std::vector<int>(x % 5, x); };
+        auto repeatList = [] (int x) { return std::list<int>(x % 3, x); };
+        CHECK(par_bind(xs, repeatVector, pool) == (xs >>= repeatVector));
+        CHECK(par_bind(ls, repeatList, pool) == (ls >>= repeatList));
+        CHECK(par_bind(xs, repeatVector, single) == (xs >>= repeatVector));
+        CHECK(par_bind(std::vector<int>{}, repeatVector, pool).empty());
+
+        auto nested = [&] (int x) { return par_bind(std::vector<int>{x, x + 1}, repeatVector, pool); };
+        auto sequential = [&] (int x) { return std::vector<int>{x, x + 1} >>= repeatVector; };
+        CHECK(par_bind(xs, nested, pool) == (xs >>= sequential));
+
+        bool thrown = false;
+        try {
+            par_bind(xs, [] (int x) -> std::vector<int> {
+                if (x == 77) {
+                    throw std::runtime_error("77");
+                }
+                return {};
+            }, pool);
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        CHECK(thrown);
+
+        // the results of f on the pool threads are built outside of the
+        // arena scope, the concatenation still uses the allocator of xs
+        monotonic_arena arena;
+        arena_scope scope(arena);
+        arena_list<int> arenaList{1, 2, 3};
+        auto negated = [] (int x) { return arena_list<int>{x, -x}; };
+        auto parallel = par_bind(arenaList, negated, pool);
+        CHECK(parallel == (arenaList >>= negated));
+        CHECK(parallel.get_allocator() == arenaList.get_allocator());
+    }
+
+    // the native applicative instances give the same results as the generic
+    // ap(ap(pure(f), x), y) built on >>=
+    void testNativeApplicative() {
+        auto plus = std::plus<>{};
+        auto genericWriter = [plus] (const auto& x, const auto& y) {
+            return monad::liftM2Impl<monad::Writer::Writer>(std::false_type{}, plus, x, y);
+        };
+        auto genericList = [plus] (const auto& x, const auto& y) {
+            return monad::liftM2Impl<std::list>(std::false_type{}, plus, x, y);
+        };
+        auto genericVector = [plus] (const auto& x, const auto& y) {
+            return monad::liftM2Impl<std::vector>(std::false_type{}, plus, x, y);
+        };
+        auto genericOptional = [plus] (const auto& x, const auto& y) {
+            return monad::liftM2Impl<optional>(std::false_type{}, plus, x, y);
+        };
+
+        std::list<int> xs{1, 2, 3};
+        std::list<int> ys{10, 20};
+        CHECK(monad::liftM2<std::list>(plus)(xs, ys) == genericList(xs, ys));
+        CHECK(monad::liftM2<std::list>(plus)(xs, std::list<int>{}).empty());
+        std::vector<int> vs{1, 2, 3};
+        std::vector<int> ws{10, 20};
+        CHECK(monad::liftM2<std::vector>(plus)(vs, ws) == genericVector(vs, ws));
+        CHECK(monad::liftM2<optional>(plus)(optional<int>{41}, optional<int>{1}).from_optional() == 42);
+        CHECK(genericOptional(optional<int>{41}, optional<int>{1}).from_optional() == 42);
+        CHECK(monad::liftM2<optional>(plus)(optional<int>{41}, optional<int>{}).is_nothing());
+        CHECK(genericOptional(optional<int>{}, optional<int>{1}).is_nothing());
+
+        using monad::Writer::writer;
+        auto x = writer(1, rope<std::string>{"x"});
+        auto y = writer(2, rope<std::string>{"y"});
+        auto native = monad::Writer::runWriter(monad::liftM2<monad::Writer::Writer>(plus)(x, y));
+        CHECK(native == monad::Writer::runWriter(genericWriter(x, y)));
+        CHECK(native.first == 3 && native.second == (std::list<std::string>{"x", "y"}));
+
+        // ap only curries functions that need further arguments
+        auto add3 = [] (int a, int b, int c) { return a + b + c; };
+        auto partial = monad::ap(monad::ap(monad::pure<std::list>(add3), xs), ys);
+        CHECK(monad::ap(partial, std::list<int>{100}) == (std::list<int>{111, 121, 112, 122, 113, 123}));
+        CHECK(monad::fmap([] (int a) { return a * 2; }, vs) == (std::vector<int>{2, 4, 6}));
+    }
+
+    // counts the instances alive, and has no default constructor
+    struct tracked {
+        static int alive;
+
+        explicit tracked(int n)
+            : n{n} {
+            alive++;
+        }
+
+        tracked(const tracked& other)
+            : n{other.n} {
+            alive++;
+        }
+
+        tracked& operator=(const tracked&) = default;
+
+        ~tracked() {
+            alive--;
+        }
+
+        int n;
+    };
+
+    int tracked::alive = 0;
+
+    // optional keeps its value in place: an empty optional constructs no T,
+    // and copies, assignments and emplace destroy every value exactly once
+    void testOptional() {
+        {
+            optional<tracked> empty{};
+            CHECK(tracked::alive == 0);
+            optional<tracked> full{tracked{1}};
+            CHECK(tracked::alive == 1);
+            optional<tracked> copy = full;
+            empty = full;
+            CHECK(tracked::alive == 3);
+            full = optional<tracked>{};
+            CHECK(tracked::alive == 2 && full.is_nothing());
+            copy.emplace(2);
+            CHECK(tracked::alive == 2 && copy->n == 2);
+            (*copy).n = 3;
+            CHECK(copy.from_optional().n == 3);
+
+            bool thrown = false;
+            try {
+                full.from_optional();
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            CHECK(thrown);
+        }
+        CHECK(tracked::alive == 0);
+
+        // binding a temporary moves the value into f
+        counted::copies = 0;
+        auto next = [] (counted x) { return optional<counted>{counted{x.n + 1}}; };
+        auto bound = (optional<counted>{counted{1}} >>= next) >>= next;
+        CHECK(bound->n == 3 && counted::copies == 0);
+        CHECK((optional<counted>{} >>= next).is_nothing());
+    }
+
+    // the loops of monad.h over a lazy and an asynchronous monad, whose steps
+    // run after the loop has moved on resp. after it has returned
+    void testDeferredLoops() {
+        auto branch = [] (int acc, int x) { return std::list<int>{acc + x, acc * x}; };
+        auto branchStream = [] (int acc, int x) { return stream<int>{acc + x, acc * x}; };
+        auto folded = monad::foldM(branch, 1, std::vector<int>{2, 3, 4});
+        CHECK(monad::foldM(branchStream, 1, std::vector<int>{2, 3, 4}).to_list() == folded);
+
+        auto twice = [] (int x) { return stream<int>{x, x + 1}; };
+        CHECK(monad::iterateM(3, twice, stream<int>{0}).to_list() == (std::list<int>{0, 1, 1, 2, 1, 2, 2, 3}));
+
+        thread_pool pool(2);
+        auto slowAdd = [&pool] (int acc, int x) {
+            return spawn([acc, x] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                return acc + x;
+            }, pool);
+        };
+        auto sum = monad::foldM(slowAdd, 0, std::vector<int>{1, 2, 3, 4, 5});
+        CHECK(sum.get() == 15);
+
+        std::atomic<int> runs{0};
+        auto run = [&runs] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return ++runs;
+        };
+        // the steps return copies of the spawned task, which share its
+        // result, so run is called once
+        auto replicated = monad::replicateM_(3, spawn(run, pool));
+        CHECK(replicated.get() == 1);
+    }
+
+    // a sink_log writes every entry when it is told, in the order of the
+    // steps of a >>= chain, and only counts them
+    void testSinkLog() {
+        using monad::Writer::writer;
+        ring_sink ring(3);
+        auto step = [&ring] (int x) { return writer(x + 1, log_to(ring, "step " + std::to_string(x))); };
+        auto start = writer(0, log_to(ring, "start"));
+        CHECK(ring.entries() == (std::vector<std::string>{"start"}));
+        auto res = monad::Writer::runWriter(monad::iterateM(100000, step, start));
+        CHECK(res.first == 100000 && res.second == 100001);
+        CHECK(ring.entries() == (std::vector<std::string>{"step 99997", "step 99998", "step 99999"}));
+        CHECK(ring.dropped() == 100001 - 3);
+        static_assert(sizeof(sink_log) == sizeof(std::size_t), "a sink_log holds only its count");
+
+        // the operands of liftM2 are written in the order they are evaluated
+        ring_sink operands(2);
+        auto x = writer(3, log_to(operands, "x"));
+        auto y = writer(4, log_to(operands, "y"));
+        auto sum = monad::Writer::runWriter(monad::liftM2<monad::Writer::Writer>(std::plus<>{})(x, y));
+        CHECK(sum.first == 7 && sum.second == 2);
+        CHECK(operands.entries() == (std::vector<std::string>{"x", "y"}));
+
+        // a log used several times is counted each time, written once
+        ring_sink replicated(4);
+        auto once = writer(1, log_to(replicated, "once"));
+        CHECK(monad::Writer::execWriter(monad::replicateM_(3, once)) == 3);
+        CHECK(replicated.entries() == (std::vector<std::string>{"once"}));
+    }
+
+    // binds keep the capacity of the inner sequences, so fixed_seq works in
+    // the loops of monad.h, and overflowing it throws
+    void testFixedSeq() {
+        using seq = fixed_seq<int, seq_capacity<8>>;
+        auto twice = [] (int x) { return seq{x, x + 1}; };
+        static_assert(std::is_same<decltype(seq{} >>= twice), seq>::value, "binds keep the type");
+        CHECK(monad::iterateM(3, twice, seq{0}) == (seq{0, 1, 1, 2, 1, 2, 2, 3}));
+        auto branch = [] (int acc, int x) { return seq{acc + x, acc * x}; };
+        CHECK(monad::foldM(branch, 1, std::vector<int>{2, 3}).size() == 4);
+
+        bool thrown = false;
+        try {
+            monad::iterateM(4, twice, seq{0});
+        } catch (const std::length_error&) {
+            thrown = true;
+        }
+        CHECK(thrown);
+        CHECK((seq{0, 1, 2, 3, 4, 5, 6, 7}.bind<seq_capacity<16>>(twice)).size() == 16);
+    }
+
+    // fmap, ap and liftM2 on streams go through >>=, for rvalue streams as
+    // well
+    void testStream() {
+        auto square = [] (int x) { return x * x; };
+        CHECK(monad::fmap(square, make_stream(std::vector<int>{1, 2, 3})).to_list() == (std::list<int>{1, 4, 9}));
+        stream<int> xs = make_stream(std::list<int>{1, 2});
+        CHECK(monad::fmap(square, xs).to_list() == (std::list<int>{1, 4}));
+        CHECK(xs.to_list() == (std::list<int>{1, 2}));
+        auto sums = monad::liftM2<stream>(std::plus<>{})(xs, make_stream(std::vector<int>{10, 20}));
+        CHECK(sums.to_vector() == (std::vector<int>{11, 21, 12, 22}));
+        CHECK(monad::join(stream<stream<int>>{xs, xs}).to_list() == (std::list<int>{1, 2, 1, 2}));
+    }
+
+    struct final_payload final {
+        int n;
+    };
+
+    // counted<T> builds for any copyable T, with and without
+    // MONAD_INSTRUMENT; with it the counts are collected per
+    // MONAD_TRACE_SCOPE and outside of any scope
+    void testInstrument() {
+        instrument::counted<int> number{3};
+        instrument::counted<int> numberCopy = number;
+        instrument::counted<final_payload> payload{final_payload{4}};
+        CHECK(numberCopy + 1 == 4 && instrument::value_of(payload).n == 4);
+
+#ifdef MONAD_INSTRUMENT
+        auto& registry = instrument::registry::instance();
+        auto stats = [&registry] (const std::string& name) {
+            for (const auto& entry : registry.sites()) {
+                if (entry.first.name == name) {
+                    return entry.second;
+                }
+            }
+            return instrument::site_stats{};
+        };
+        auto counts = [] (const instrument::site_stats& siteStats, instrument::counter c) {
+            return siteStats.counts[static_cast<std::size_t>(c)];
+        };
+        auto half = [] (int x) { return x % 2 == 0 ? optional<int>{x / 2} : optional<int>{}; };
+
+        registry.reset();
+        {
+            MONAD_TRACE_SCOPE("tests: halve twice");
+            instrument::counted<int> copied = number;
+            CHECK(*((optional<int>{8} >>= half) >>= half) == 2);
+            CHECK(copied == 3);
+        }
+        auto scoped = stats("tests: halve twice");
+        CHECK(scoped.calls == 1);
+        CHECK(counts(scoped, instrument::counter::binds) == 2);
+        CHECK(counts(scoped, instrument::counter::rvalue_binds) == 2);
+        CHECK(counts(scoped, instrument::counter::copies) == 1);
+
+        // the main thread doesn't end before the report is taken
+        instrument::counted<int> unscopedCopy = number;
+        CHECK(((optional<int>{4} >>= half) >>= half).from_optional() == 1);
+        auto unscoped = stats("(unscoped)");
+        CHECK(counts(unscoped, instrument::counter::binds) == 2);
+        CHECK(counts(unscoped, instrument::counter::copies) == 1);
+        CHECK(unscopedCopy == 3);
+#endif
+    }
+
+    // the capacity bounds the cached results in total, also with fewer
+    // results than shards
+    void testMemoize() {
+        int calls = 0;
+        auto square = memoize([&calls] (int x) { calls++; return x * x; }, memo_options{4, 16, memo_eviction::fifo});
+        for (int x = 0; x < 6; x++) {
+            CHECK(square(x) == x * x);
+        }
+        CHECK(square(5) == 25 && calls == 6);
+        CHECK(square.stats().size == 4);
+        CHECK(square.stats().hits == 1);
+
+        auto uneven = memoize([] (int x) { return x + 1; }, memo_options{10, 4, memo_eviction::lru});
+        for (int x = 0; x < 100; x++) {
+            uneven(x);
+        }
+        CHECK(uneven.stats().size <= 10);
+
+        auto curried = curry(memoize([] (int a, int b) noexcept { return a * b; }));
+        CHECK(curried(6)(7) == 42);
+    }
+    // a thread keeps one buffer per collector when switching between them,
+    // also after logging to many short-lived ones in between
+    void testConcurrentLog() {
+        log_collector first, second;
+        concurrent_log log = log_to(first, "a") + log_to(second, "b") + log_to(first, "c");
+        for (int i = 0; i < 1000; i++) {
+            log_collector request;
+            log_to(request, "request");
+            CHECK(request.threads() == 1);
+        }
+        log = log + log_to(second, "d") + log_to(first, "e");
+        CHECK(first.threads() == 1 && second.threads() == 1);
+        std::vector<log_record> records = materialize(log);
+        CHECK(records.size() == 5);
+        CHECK(records[0].entry == "a" && records[2].entry == "c" && records[4].entry == "e");
+        CHECK(records[3].entry == "d");
+    }
+    // a curried mutable lambda can be called as a non-const lvalue, partial
+    // applications copy its state
+    void testCurryMutable() {
+        auto next = curry([calls = 0] (int a, int b) mutable { return a + b + calls++; });
+        CHECK(next(1, 2) == 3);
+        CHECK(next(1, 2) == 4);
+        auto addOne = next(1);
+        CHECK(addOne(2) == 5 && addOne(2) == 6);
+        CHECK(next(1)(2) == 5);
+        const auto constNext = curry([] (int a, int b) { return a * b; });
+        CHECK(constNext(2)(3) == 6);
+    }
+    // calling an empty unique_function throws instead of calling through null
+    void testUniqueFunction() {
+        unique_function<int(int)> empty;
+        bool thrown = false;
+        try {
+            empty(1);
+        } catch (const std::bad_function_call&) {
+            thrown = true;
+        }
+        CHECK(thrown && !empty);
+
+        unique_function<int(int)> twice{[] (int x) { return 2 * x; }};
+        unique_function<int(int)> moved{std::move(twice)};
+        CHECK(moved(21) == 42);
+        thrown = false;
+        try {
+            twice(1);
+        } catch (const std::bad_function_call&) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+} // namespace
+
+int main() {
+    testRope();
+    testWriterRvalueBinds();
+    testNegateVector();
+    testParBind();
+    testNativeApplicative();
+    testOptional();
+    testDeferredLoops();
+    testSinkLog();
+    testFixedSeq();
+    testStream();
+    testInstrument();
+    testMemoize();
+    testConcurrentLog();
+    testCurryMutable();
+    testUniqueFunction();
+
+    if (failures > 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+}
@@ -0,0 +1,158 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A fixed-size work-stealing thread pool. Every worker owns a deque: tasks
+// submitted from a worker go to the back of its own deque and are popped from
+// there (LIFO, cache friendly), idle workers steal from the front of the
+// other deques. Tasks submitted from outside the pool are distributed round
+// robin.
+//
+// Threads waiting for the result of submitted tasks should call
+// run_pending_task() in their wait loop instead of blocking, so nested
+// parallel sections can't deadlock the pool.
+class thread_pool {
+public:
+    explicit thread_pool(std::size_t threadCount = std::max(1u, std::thread::hardware_concurrency()))
+        : _stop{false}
+        , _pending{0}
+        , _nextQueue{0} {
+        threadCount = std::max<std::size_t>(threadCount, 1);
+        for (std::size_t i = 0; i < threadCount; i++) {
+            _queues.push_back(std::make_unique<worker_queue>());
+        }
+        for (std::size_t i = 0; i < threadCount; i++) {
+            _threads.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    // finishes all queued tasks before joining the workers
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(_wakeMutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (auto& thread : _threads) {
+            thread.join();
+        }
+    }
+
+    std::size_t size() const {
+        return _threads.size();
+    }
+
+    template <typename funcType>
+    void submit(funcType&& f) {
+        std::size_t queueIndex = currentWorker().first == this
+            ? currentWorker().second
+            : _nextQueue.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+        // counted before it is queued so _pending never underflows when a
+        // worker grabs the task right away
+        {
+            std::lock_guard<std::mutex> lock(_wakeMutex);
+            ++_pending;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_queues[queueIndex]->mutex);
+            _queues[queueIndex]->tasks.emplace_back(std::forward<funcType>(f));
+        }
+        _wake.notify_one();
+    }
+
+    // runs one queued task on the calling thread, returns false if there was
+    // none
+    bool run_pending_task() {
+        std::function<void()> task;
+        std::size_t home = currentWorker().first == this ? currentWorker().second : 0;
+        if (!tryPop(home, task)) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+    // the pool used by the parallel combinators unless one is passed
+    // explicitly
+    static thread_pool& default_pool() {
+        static thread_pool pool;
+        return pool;
+    }
+
+private:
+    struct worker_queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // the pool and queue index of the calling thread if it is a worker
+    static std::pair<thread_pool*, std::size_t>& currentWorker() {
+        static thread_local std::pair<thread_pool*, std::size_t> worker{nullptr, 0};
+        return worker;
+    }
+
+    // pops from the back of the home queue, otherwise steals from the front
+    // of the others
+    bool tryPop(std::size_t home, std::function<void()>& task) {
+        {
+            std::lock_guard<std::mutex> lock(_queues[home]->mutex);
+            if (!_queues[home]->tasks.empty()) {
+                task = std::move(_queues[home]->tasks.back());
+                _queues[home]->tasks.pop_back();
+                --_pending;
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < _queues.size(); i++) {
+            auto& victim = *_queues[(home + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                --_pending;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(std::size_t index) {
+        currentWorker() = std::make_pair(this, index);
+        std::function<void()> task;
+        while (true) {
+            if (tryPop(index, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(_wakeMutex);
+            _wake.wait(lock, [this] { return _stop || _pending > 0; });
+            if (_stop && _pending == 0) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<worker_queue>> _queues;
+    std::vector<std::thread> _threads;
+    std::mutex _wakeMutex;
+    std::condition_variable _wake;
+    bool _stop;
+    std::atomic<std::size_t> _pending;
+    std::atomic<std::size_t> _nextQueue;
+};
+
+#endif
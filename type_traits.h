@@ -13,23 +13,31 @@ using type_t = T;
 
 
 
-// check wether a given type is of the form Container<T> for
-// some type T and a fixed type constructor Container.
+// checks whether two type constructors are the same
+template <template <typename, typename...> class, template <typename, typename...> class>
+struct is_same_template : std::false_type {};
+
+template <template <typename, typename...> class Container>
+struct is_same_template<Container, Container> : std::true_type {};
+
+// check wether a given type is of the form Container<T, ...> for
+// some type T and a fixed type constructor Container. The further
+// arguments, e.g. the allocator of a std::list, are arbitrary.
 template <template <typename, typename...> class, typename>
 struct is_container : std::false_type {};
 
-template <template <typename, typename...> class Container, template <typename, typename...> class actualContainer, typename T>
-struct is_container<Container, actualContainer<T>> : std::is_same<Container<T>, actualContainer<T>> {};
+template <template <typename, typename...> class Container, template <typename, typename...> class actualContainer, typename T, typename... Rest>
+struct is_container<Container, actualContainer<T, Rest...>> : is_same_template<Container, actualContainer> {};
 
 // For a fixed type constructor Container and a given type
-// T, returns type U if T = Container<U> for some type U and returns
-// nothing if T is not of the form Container<U> for any type U.
+// T, returns type U if T = Container<U, ...> for some type U and returns
+// nothing if T is not of the form Container<U, ...> for any type U.
 template <template <typename, typename...> class, typename>
 struct remove_container;
 
-template <template <typename, typename...> class ContainerToRemove, template <typename, typename...> class ActualContainer, typename T>
-struct remove_container<ContainerToRemove, ActualContainer<T>>
-    : std::enable_if<std::is_same<ContainerToRemove<T>, ActualContainer<T>>{}(), T>
+template <template <typename, typename...> class ContainerToRemove, template <typename, typename...> class ActualContainer, typename T, typename... Rest>
+struct remove_container<ContainerToRemove, ActualContainer<T, Rest...>>
+    : std::enable_if<is_same_template<ContainerToRemove, ActualContainer>{}(), T>
 {};
 
 // convenience wrapper around remove_container
@@ -41,7 +49,25 @@ using remove_container_t = typename remove_container<ContainerToRemove, T>::type
 template <typename>
 struct is_nested_container : std::false_type {};
 
-template <template <typename, typename...> class Container, typename T>
-struct is_nested_container<Container<Container<T>>> : std::true_type {};
+template <template <typename, typename...> class Container, typename T, typename... Inner, typename... Outer>
+struct is_nested_container<Container<Container<T, Inner...>, Outer...>> : std::true_type {};
+
+// an empty container of type C that allocates with alloc, converted to the
+// allocator type of C, if that is possible and a default constructed one
+// otherwise; keeps the results of an operation in the allocator of its input
+template <typename C, typename Alloc>
+C empty_with_allocator(const Alloc& alloc, std::true_type) {
+    return C(typename C::allocator_type(alloc));
+}
+
+template <typename C, typename Alloc>
+C empty_with_allocator(const Alloc&, std::false_type) {
+    return C{};
+}
+
+template <typename C, typename Alloc>
+C empty_with_allocator(const Alloc& alloc) {
+    return empty_with_allocator<C>(alloc, std::is_constructible<typename C::allocator_type, const Alloc&>{});
+}
 
 #endif
@@ -0,0 +1,136 @@
+#ifndef VECTOR_H
+#define VECTOR_H
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include "applicative.h"
+#include "cpp17.h"
+#include "instrument.h"
+#include "simd.h"
+#include "type_traits.h"
+
+// Monad instance for std::vector. Like list.h this has to be included before
+// monad.h so that the combinators there can find operator>>=.
+//
+// The inner results of f are collected first so the result can be allocated
+// once with their total size. For ap this is the product of the input sizes.
+// As in list.h, results are built with the allocator of the input.
+
+template <typename T, typename A, typename funcType>
+auto operator>>= (const std::vector<T, A>& vec, funcType&& f)
+    -> std::enable_if_t<is_container<std::vector, decltype(f(std::declval<T>()))>{}(), decltype(f(std::declval<T>()))> {
+        MONAD_COUNT_LVALUE_BIND();
+        std::vector<decltype(f(std::declval<T>()))> results{};
+        results.reserve(vec.size());
+        std::size_t totalSize = 0;
+        for (const auto& elem : vec) {
+            results.push_back(f(elem));
+            totalSize += results.back().size();
+        }
+        auto returnVec = empty_with_allocator<decltype(f(std::declval<T>()))>(vec.get_allocator());
+        returnVec.reserve(totalSize);
+        for (auto& result : results) {
+            returnVec.insert(returnVec.end(), std::make_move_iterator(result.begin()), std::make_move_iterator(result.end()));
+        }
+        return returnVec;
+}
+
+template <typename T, typename A, typename funcType>
+auto operator>>= (std::vector<T, A>&& vec, funcType&& f) -> std::enable_if_t<is_container<std::vector, decltype(f(std::declval<T>()))>{}(), decltype(f(std::declval<T>()))> {
+    MONAD_COUNT_RVALUE_BIND();
+    std::vector<decltype(f(std::declval<T>()))> results{};
+    results.reserve(vec.size());
+    std::size_t totalSize = 0;
+    for (auto&& elem : vec) {
+        results.push_back(f(std::move(elem)));
+        totalSize += results.back().size();
+    }
+    auto returnVec = empty_with_allocator<decltype(f(std::declval<T>()))>(vec.get_allocator());
+    returnVec.reserve(totalSize);
+    for (auto& result : results) {
+        returnVec.insert(returnVec.end(), std::make_move_iterator(result.begin()), std::make_move_iterator(result.end()));
+    }
+    return returnVec;
+}
+
+namespace monad {
+    // fmap and liftA2 with the arithmetic functors or simd_safe functions of
+    // simd.h over numbers run the vectorized kernels there
+    template <>
+    struct native_applicative<std::vector> : std::true_type {
+        template <typename U, typename A>
+        using rebound_vector = std::vector<U, typename std::allocator_traits<A>::template rebind_alloc<U>>;
+
+        template <typename funcType, typename T, typename A>
+        static auto fmap(funcType&& f, const std::vector<T, A>& x) {
+            using R = std::decay_t<decltype(f(std::declval<const T&>()))>;
+            return fmapImpl(simd::is_vectorizable_unary<funcType, T, R>{}, std::forward<funcType>(f), x);
+        }
+
+        template <typename funcType, typename T, typename A>
+        static auto fmap(funcType&& f, std::vector<T, A>&& x) {
+            using R = std::decay_t<decltype(f(std::declval<T>()))>;
+            return fmapImpl(simd::is_vectorizable_unary<funcType, T, R>{}, std::forward<funcType>(f), std::move(x));
+        }
+
+        template <typename funcType, typename T1, typename A1, typename T2, typename A2>
+        static auto liftA2(funcType&& f, const std::vector<T1, A1>& x, const std::vector<T2, A2>& y) {
+            using R = std::decay_t<decltype(f(std::declval<const T1&>(), std::declval<const T2&>()))>;
+            return liftA2Impl(simd::is_vectorizable_binary<funcType, T1, T2, R>{}, std::forward<funcType>(f), x, y);
+        }
+
+    private:
+        template <typename funcType, typename T, typename A>
+        static auto fmapImpl(std::false_type, funcType&& f, const std::vector<T, A>& x) {
+            using result_t = rebound_vector<std::decay_t<decltype(f(std::declval<const T&>()))>, A>;
+            result_t returnVec(typename result_t::allocator_type(x.get_allocator()));
+            returnVec.reserve(x.size());
+            for (const auto& elem : x) {
+                returnVec.push_back(f(elem));
+            }
+            return returnVec;
+        }
+
+        template <typename funcType, typename T, typename A>
+        static auto fmapImpl(std::false_type, funcType&& f, std::vector<T, A>&& x) {
+            using result_t = rebound_vector<std::decay_t<decltype(f(std::declval<T>()))>, A>;
+            result_t returnVec(typename result_t::allocator_type(x.get_allocator()));
+            returnVec.reserve(x.size());
+            for (auto&& elem : x) {
+                returnVec.push_back(f(std::move(elem)));
+            }
+            return returnVec;
+        }
+
+        template <typename funcType, typename T, typename A>
+        static auto fmapImpl(std::true_type, const funcType& f, const std::vector<T, A>& x) {
+            using result_t = rebound_vector<std::decay_t<decltype(f(std::declval<const T&>()))>, A>;
+            result_t returnVec(x.size(), typename result_t::value_type{}, typename result_t::allocator_type(x.get_allocator()));
+            simd::map(f, x.data(), returnVec.data(), x.size());
+            return returnVec;
+        }
+
+        template <typename funcType, typename T1, typename A1, typename T2, typename A2>
+        static auto liftA2Impl(std::false_type, funcType&& f, const std::vector<T1, A1>& x, const std::vector<T2, A2>& y) {
+            using result_t = rebound_vector<std::decay_t<decltype(f(std::declval<const T1&>(), std::declval<const T2&>()))>, A1>;
+            result_t returnVec(typename result_t::allocator_type(x.get_allocator()));
+            returnVec.reserve(x.size() * y.size());
+            for (const auto& elem1 : x) {
+                for (const auto& elem2 : y) {
+                    returnVec.push_back(f(elem1, elem2));
+                }
+            }
+            return returnVec;
+        }
+
+        template <typename funcType, typename T1, typename A1, typename T2, typename A2>
+        static auto liftA2Impl(std::true_type, const funcType& f, const std::vector<T1, A1>& x, const std::vector<T2, A2>& y) {
+            using result_t = rebound_vector<std::decay_t<decltype(f(std::declval<const T1&>(), std::declval<const T2&>()))>, A1>;
+            result_t returnVec(x.size() * y.size(), typename result_t::value_type{}, typename result_t::allocator_type(x.get_allocator()));
+            simd::cartesian(f, x.data(), x.size(), y.data(), y.size(), returnVec.data());
+            return returnVec;
+        }
+    };
+} // namespace monad
+#endif
@@ -5,48 +5,75 @@
 #include <string>
 #include <tuple>
 #include <type_traits>
+#include "applicative.h"
 #include "cpp17.h"
 #include "curry.h"
+#include "instrument.h"
 #include "monad.h"
 #include "monoid.h"
+#include "rope.h"
 
 
 namespace monad {
     namespace Writer {
-        template <typename T, typename W = std::list<std::string>>
+        template <typename T, typename W = rope<std::string>>
         class Writer {
         public:
             Writer(T val)
                 : _log{}
-                , _val{val} {
+                , _val{std::move(val)} {
             }
 
             Writer(T val, W log)
-                : _log{log}
-                , _val{val} {
+                : _log{std::move(log)}
+                , _val{std::move(val)} {
             }
 
-            W execWriter() const {
-                return _log;
+            auto execWriter() const& {
+                return materialize(_log);
             }
 
-            auto runWriter() const {
-                return std::make_pair(_val, _log);
+            auto execWriter() && {
+                return materialize(std::move(_log));
+            }
+
+            auto runWriter() const& {
+                return std::make_pair(_val, materialize(_log));
+            }
+
+            auto runWriter() && {
+                return std::make_pair(std::move(_val), materialize(std::move(_log)));
             }
 
             template <typename funcType>
-            auto operator>>=(funcType&& f) const;
+            auto operator>>=(funcType&& f) const&;
+
+            // moves the value into f and the log into the result
+            template <typename funcType>
+            auto operator>>=(funcType&& f) &&;
 
         private:
+            template <typename, typename>
+            friend class Writer;
+
+            template <template <typename, typename...> class>
+            friend struct ::monad::native_applicative;
+
             W _log;
             std::remove_reference_t<T> _val;
             // bind if f returns writer<void, W>
             template <typename funcType>
-            auto bindImpl(std::true_type, funcType&& f) const;
+            auto bindImpl(std::true_type, funcType&& f) const&;
+
+            template <typename funcType>
+            auto bindImpl(std::true_type, funcType&& f) &&;
 
             // bind if f returns writer<T, W> with T != void
             template <typename funcType>
-            auto bindImpl(std::false_type, funcType&& f) const;
+            auto bindImpl(std::false_type, funcType&& f) const&;
+
+            template <typename funcType>
+            auto bindImpl(std::false_type, funcType&& f) &&;
         };
 
         // specialization for void
@@ -58,25 +85,42 @@ namespace monad {
             }
 
             Writer(W log)
-                : _log{log} {
+                : _log{std::move(log)} {
             }
 
-            W execWriter() const {
-                return _log;
+            auto execWriter() const& {
+                return materialize(_log);
+            }
+
+            auto execWriter() && {
+                return materialize(std::move(_log));
             }
 
             template <typename funcType>
-            auto operator>>=(funcType&& f) const;
+            auto operator>>=(funcType&& f) const&;
+
+            // moves the log into the result
+            template <typename funcType>
+            auto operator>>=(funcType&& f) &&;
 
         private:
+            template <typename, typename>
+            friend class Writer;
+
             W _log;
             // bind if f returns writer<void, W>
             template <typename funcType>
-            auto bindImpl(std::true_type, funcType&& f) const;
+            auto bindImpl(std::true_type, funcType&& f) const&;
+
+            template <typename funcType>
+            auto bindImpl(std::true_type, funcType&& f) &&;
 
             // bind if f returns writer<T, W> with T!= void
             template <typename funcType>
-            auto bindImpl(std::false_type, funcType&& f) const;
+            auto bindImpl(std::false_type, funcType&& f) const&;
+
+            template <typename funcType>
+            auto bindImpl(std::false_type, funcType&& f) &&;
         };
 
         namespace traits {
@@ -110,54 +154,94 @@ namespace monad {
 
         template <typename T, typename W>
         template <typename funcType>
-        auto Writer<T,W>::bindImpl(std::false_type, funcType&& f) const {
-            auto res_f = f(_val).runWriter();
-            return Writer<traits::writer_base_t<decltype(f(std::declval<T>()))>, W> { std::get<0>(res_f), _log + std::get<1>(res_f) };
+        auto Writer<T,W>::bindImpl(std::false_type, funcType&& f) const& {
+            auto res_f = f(_val);
+            return Writer<traits::writer_base_t<decltype(f(std::declval<T>()))>, W> { std::move(res_f._val), _log + std::move(res_f._log) };
+        }
+
+        template <typename T, typename W>
+        template <typename funcType>
+        auto Writer<T,W>::bindImpl(std::false_type, funcType&& f) && {
+            auto res_f = f(std::move(_val));
+            return Writer<traits::writer_base_t<decltype(f(std::declval<T>()))>, W> { std::move(res_f._val), std::move(_log) + std::move(res_f._log) };
+        }
+
+        template <typename T, typename W>
+        template <typename funcType>
+        auto Writer<T, W>::bindImpl(std::true_type, funcType&& f) const& {
+            return Writer<void, W> { _log + f(_val)._log };
         }
 
         template <typename T, typename W>
         template <typename funcType>
-        auto Writer<T, W>::bindImpl(std::true_type, funcType&& f) const {
-            return Writer<void, W> { _log + f(_val).execWriter()};
+        auto Writer<T, W>::bindImpl(std::true_type, funcType&& f) && {
+            return Writer<void, W> { std::move(_log) + f(std::move(_val))._log };
         }
 
         template <typename T, typename W>
         template <typename funcType>
-        auto Writer<T,W>::operator>>=(funcType&& f) const {
+        auto Writer<T,W>::operator>>=(funcType&& f) const& {
            //TODO: static asserts
+           MONAD_COUNT_LVALUE_BIND();
            return bindImpl(std::is_same<traits::writer_base_t<decltype(f(std::declval<T>()))>, void>{}, std::forward<funcType>(f));
         }
 
+        template <typename T, typename W>
+        template <typename funcType>
+        auto Writer<T,W>::operator>>=(funcType&& f) && {
+           MONAD_COUNT_RVALUE_BIND();
+           return std::move(*this).bindImpl(std::is_same<traits::writer_base_t<decltype(f(std::declval<T>()))>, void>{}, std::forward<funcType>(f));
+        }
+
+        template <typename W>
+        template <typename funcType>
+        auto Writer<void, W>::bindImpl(std::true_type, funcType&& f) const& {
+           return Writer<void, W> { _log + f()._log };
+        }
+
         template <typename W>
         template <typename funcType>
-        auto Writer<void, W>::bindImpl(std::true_type, funcType&& f) const {
-           return Writer<void, W> { _log + f().execWriter() };
+        auto Writer<void, W>::bindImpl(std::true_type, funcType&& f) && {
+           return Writer<void, W> { std::move(_log) + f()._log };
         }
 
         template <typename W>
         template <typename funcType>
-        auto Writer<void, W>::bindImpl(std::false_type, funcType&& f) const {
-            traits::writer_base_t<decltype(f())> f_val;
-            W f_log;
-            std::tie(f_val, f_log) = f().runWriter();
-            return Writer<traits::writer_base_t<decltype(f())>, W> { f_val, _log + f_log };
+        auto Writer<void, W>::bindImpl(std::false_type, funcType&& f) const& {
+            auto res_f = f();
+            return Writer<traits::writer_base_t<decltype(f())>, W> { std::move(res_f._val), _log + std::move(res_f._log) };
         }
 
         template <typename W>
         template <typename funcType>
-        auto Writer<void, W>::operator>>=(funcType&& f) const {
+        auto Writer<void, W>::bindImpl(std::false_type, funcType&& f) && {
+            auto res_f = f();
+            return Writer<traits::writer_base_t<decltype(f())>, W> { std::move(res_f._val), std::move(_log) + std::move(res_f._log) };
+        }
+
+        template <typename W>
+        template <typename funcType>
+        auto Writer<void, W>::operator>>=(funcType&& f) const& {
             // TODO: static asserts
+            MONAD_COUNT_LVALUE_BIND();
             return bindImpl(std::is_same<traits::writer_base_t<decltype(f())>, void>{}, std::forward<decltype(f)>(f));
         }
 
+        template <typename W>
+        template <typename funcType>
+        auto Writer<void, W>::operator>>=(funcType&& f) && {
+            MONAD_COUNT_RVALUE_BIND();
+            return std::move(*this).bindImpl(std::is_same<traits::writer_base_t<decltype(f())>, void>{}, std::forward<decltype(f)>(f));
+        }
+
         template <typename T, typename W>
         auto writer(T&& val, W&& log) {
-            return Writer<std::decay_t<std::remove_reference_t<T>>, W>(std::forward<decltype(val)>(val), std::forward<decltype(log)>(log));
+            return Writer<std::decay_t<std::remove_reference_t<T>>, std::decay_t<W>>(std::forward<decltype(val)>(val), std::forward<decltype(log)>(log));
         }
 
         template<typename W>
         auto tell(W&& log) {
-            return Writer<void, W> { std::forward<decltype(log)>(log) };
+            return Writer<void, std::decay_t<W>> { std::forward<decltype(log)>(log) };
         }
 
         template <typename T, typename W>
@@ -165,10 +249,38 @@ namespace monad {
             return writer.runWriter();
         }
 
+        template <typename T, typename W>
+        auto runWriter(Writer<T, W>&& writer) {
+            return std::move(writer).runWriter();
+        }
+
         template <typename T, typename W>
         auto execWriter(const Writer<T, W>& writer) {
             return writer.execWriter();
         }
+
+        template <typename T, typename W>
+        auto execWriter(Writer<T, W>&& writer) {
+            return std::move(writer).execWriter();
+        }
     } // namespace monad::Writer
+
+    template <>
+    struct native_applicative<Writer::Writer> : std::true_type {
+        template <typename funcType, typename T, typename W>
+        static auto fmap(funcType&& f, const Writer::Writer<T, W>& x) {
+            return Writer::Writer<std::decay_t<decltype(f(std::declval<const T&>()))>, W> { f(x._val), x._log };
+        }
+
+        template <typename funcType, typename T, typename W>
+        static auto fmap(funcType&& f, Writer::Writer<T, W>&& x) {
+            return Writer::Writer<std::decay_t<decltype(f(std::declval<T>()))>, W> { f(std::move(x._val)), std::move(x._log) };
+        }
+
+        template <typename funcType, typename T1, typename T2, typename W>
+        static auto liftA2(funcType&& f, const Writer::Writer<T1, W>& x, const Writer::Writer<T2, W>& y) {
+            return Writer::Writer<std::decay_t<decltype(f(std::declval<const T1&>(), std::declval<const T2&>()))>, W> { f(x._val, y._val), x._log + y._log };
+        }
+    };
 } // namespace monad
 #endif
@@ -0,0 +1,292 @@
+#ifndef WRITER_T_H
+#define WRITER_T_H
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include "expected.h"
+#include "optional.h"
+#include "writer.h"
+
+// WriterT<T, W, over<Base>> is the Writer monad on top of a monad Base that
+// may fail, optional or Expected, i.e. a computation that logs to W and stops
+// at the first failure:
+//
+//     using Parsed = WriterT<int, rope<std::string>, over<Expected>>;
+//     Parsed parse(const std::string& str);
+//     Parsed checked = parse(input) >>= [] (int x) -> Parsed {
+//         if (x < 0) {
+//             return make_unexpected(std::make_error_code(std::errc::result_out_of_range));
+//         }
+//         return {x, rope<std::string>{"checked"}};
+//     };
+//     auto res = runWriterT(checked);  // Expected<std::pair<int, std::list<std::string>>>
+//
+// Instead of nesting optional<Writer<T, W>> or Writer<optional<T>, W>, the
+// flag, the value (or error) and the log are kept in a single object and
+// each >>= is a single step. As in Haskell's WriterT over Maybe, a failure
+// has no log: the log written before it is dropped, and binding a failure
+// only passes the error on without copying or appending any log.
+//
+// The base monad is over<optional> (the default), over<Expected> for
+// Expected<T, std::error_code>, or over<Expected, E> for other errors E. A
+// value of the base monad converts to a WriterT with an empty log, so steps
+// can return optional<T>{} resp. make_unexpected(e) to fail. As for monad.h,
+// list.h and vector.h have to be included before this header.
+
+template <template <typename, typename...> class Base, typename... BaseArgs>
+struct over {};
+
+namespace monad {
+    namespace Writer {
+        namespace detail {
+            // the error a failed WriterT stores and the conversions from
+            // and to its base monad
+            template <typename Base>
+            struct base_monad;
+
+            template <>
+            struct base_monad<over<optional>> {
+                // an empty optional carries no information
+                struct error_type {};
+
+                template <typename T>
+                using type = optional<T>;
+
+                template <typename T>
+                static bool hasValue(const optional<T>& x) {
+                    return !x.is_nothing();
+                }
+
+                template <typename T>
+                static error_type error(const optional<T>&) {
+                    return error_type{};
+                }
+
+                template <typename T>
+                static optional<T> failure(const error_type&) {
+                    return optional<T>{};
+                }
+            };
+
+            template <typename E>
+            struct base_monad<over<Expected, E>> {
+                using error_type = E;
+
+                template <typename T>
+                using type = Expected<T, E>;
+
+                template <typename T>
+                static bool hasValue(const Expected<T, E>& x) {
+                    return x.has_value();
+                }
+
+                template <typename T>
+                static const E& error(const Expected<T, E>& x) {
+                    return x.error();
+                }
+
+                template <typename T>
+                static E&& error(Expected<T, E>&& x) {
+                    return std::move(x).error();
+                }
+
+                template <typename T, typename Error>
+                static Expected<T, E> failure(Error&& error) {
+                    return make_unexpected(std::forward<Error>(error));
+                }
+            };
+
+            template <>
+            struct base_monad<over<Expected>> : base_monad<over<Expected, std::error_code>> {};
+        } // namespace monad::Writer::detail
+
+        template <typename T, typename W = rope<std::string>, typename Base = over<optional>>
+        class WriterT : private ::detail::expected_storage<T, typename detail::base_monad<Base>::error_type> {
+            static_assert(!std::is_reference<T>::value, "WriterT of a reference type is not supported");
+
+            using base_monad = detail::base_monad<Base>;
+            using storage = ::detail::expected_storage<T, typename base_monad::error_type>;
+
+        public:
+            using value_type = T;
+            using log_type = W;
+            using error_type = typename base_monad::error_type;
+            using base_type = typename base_monad::template type<T>;
+
+            WriterT(T val)
+                : storage(std::true_type{}, std::move(val))
+                , _log{} {
+            }
+
+            WriterT(T val, W log)
+                : storage(std::true_type{}, std::move(val))
+                , _log{std::move(log)} {
+            }
+
+            // lifts a value of the base monad, with an empty log
+            WriterT(const base_type& x)
+                : WriterT(base_monad::hasValue(x) ? WriterT{*x} : WriterT{std::false_type{}, base_monad::error(x)}) {
+            }
+
+            WriterT(base_type&& x)
+                : WriterT(base_monad::hasValue(x) ? WriterT{*std::move(x)} : WriterT{std::false_type{}, base_monad::error(std::move(x))}) {
+            }
+
+            template <typename G, typename = std::enable_if_t<std::is_constructible<error_type, G&&>::value>>
+            WriterT(unexpected<G> error)
+                : WriterT{std::false_type{}, std::move(error.error)} {
+            }
+
+            bool has_value() const {
+                return this->_hasValue;
+            }
+
+            explicit operator bool() const {
+                return has_value();
+            }
+
+            // a failure ends every chain it is bound into, see monad::short_circuits
+            bool is_nothing() const {
+                return !has_value();
+            }
+
+            // unchecked access, the WriterT must hold a value resp. an error
+            T& operator*() & {
+                return this->_val;
+            }
+
+            const T& operator*() const& {
+                return this->_val;
+            }
+
+            T&& operator*() && {
+                return std::move(this->_val);
+            }
+
+            const error_type& error() const& {
+                return this->_error;
+            }
+
+            error_type&& error() && {
+                return std::move(this->_error);
+            }
+
+            // the log written so far, empty for a failure
+            const W& log() const& {
+                return _log;
+            }
+
+            W&& log() && {
+                return std::move(_log);
+            }
+
+            // the value and the materialized log in the base monad
+            auto runWriterT() const& {
+                using pair_t = std::pair<T, decltype(materialize(_log))>;
+                if (!has_value()) {
+                    return base_monad::template failure<pair_t>(this->_error);
+                }
+                return typename base_monad::template type<pair_t>{pair_t{this->_val, materialize(_log)}};
+            }
+
+            auto runWriterT() && {
+                using pair_t = std::pair<T, decltype(materialize(std::move(_log)))>;
+                if (!has_value()) {
+                    return base_monad::template failure<pair_t>(std::move(this->_error));
+                }
+                return typename base_monad::template type<pair_t>{pair_t{std::move(this->_val), materialize(std::move(_log))}};
+            }
+
+            template <typename funcType>
+            auto operator>>=(funcType&& f) const& {
+                MONAD_COUNT_LVALUE_BIND();
+                using result_t = decltype(f(std::declval<const T&>()));
+                checkStep<result_t>();
+                if (!has_value()) {
+                    return result_t{std::false_type{}, this->_error};
+                }
+                auto res = f(this->_val);
+                if (res.has_value()) {
+                    res._log = _log + std::move(res._log);
+                }
+                return res;
+            }
+
+            // moves the value into f resp. the error into the result, and the
+            // log in front of the log of f
+            template <typename funcType>
+            auto operator>>=(funcType&& f) && {
+                MONAD_COUNT_RVALUE_BIND();
+                using result_t = decltype(f(std::declval<T>()));
+                checkStep<result_t>();
+                if (!has_value()) {
+                    return result_t{std::false_type{}, std::move(this->_error)};
+                }
+                auto res = f(std::move(this->_val));
+                if (res.has_value()) {
+                    res._log = std::move(_log) + std::move(res._log);
+                }
+                return res;
+            }
+
+        private:
+            template <typename, typename, typename>
+            friend class WriterT;
+
+            template <template <typename, typename...> class>
+            friend struct ::monad::native_applicative;
+
+            // a failure with the given error and an empty log
+            template <typename Error>
+            WriterT(std::false_type, Error&& error)
+                : storage(std::false_type{}, std::forward<Error>(error))
+                , _log{} {
+            }
+
+            template <typename Result>
+            static void checkStep() {
+                static_assert(std::is_same<Result, WriterT<typename Result::value_type, W, Base>>::value,
+                    "the function bound to a WriterT has to return a WriterT with the same log and base monad");
+            }
+
+            W _log;
+        };
+
+        template <typename T, typename W, typename Base>
+        auto runWriterT(const WriterT<T, W, Base>& writer) {
+            return writer.runWriterT();
+        }
+
+        template <typename T, typename W, typename Base>
+        auto runWriterT(WriterT<T, W, Base>&& writer) {
+            return std::move(writer).runWriterT();
+        }
+    } // namespace monad::Writer
+
+    // the first failure of the arguments, from left to right, is the result
+    template <>
+    struct native_applicative<Writer::WriterT> : std::true_type {
+        template <typename funcType, typename T, typename W, typename Base>
+        static auto fmap(funcType&& f, const Writer::WriterT<T, W, Base>& x) {
+            using result_t = Writer::WriterT<std::decay_t<decltype(f(std::declval<const T&>()))>, W, Base>;
+            return x.has_value() ? result_t{f(*x), x._log} : result_t{std::false_type{}, x.error()};
+        }
+
+        template <typename funcType, typename T, typename W, typename Base>
+        static auto fmap(funcType&& f, Writer::WriterT<T, W, Base>&& x) {
+            using result_t = Writer::WriterT<std::decay_t<decltype(f(std::declval<T>()))>, W, Base>;
+            return x.has_value() ? result_t{f(*std::move(x)), std::move(x._log)} : result_t{std::false_type{}, std::move(x).error()};
+        }
+
+        template <typename funcType, typename T1, typename T2, typename W, typename Base>
+        static auto liftA2(funcType&& f, const Writer::WriterT<T1, W, Base>& x, const Writer::WriterT<T2, W, Base>& y) {
+            using result_t = Writer::WriterT<std::decay_t<decltype(f(std::declval<const T1&>(), std::declval<const T2&>()))>, W, Base>;
+            if (!x.has_value()) {
+                return result_t{std::false_type{}, x.error()};
+            }
+            return y.has_value() ? result_t{f(*x, *y), x._log + y._log} : result_t{std::false_type{}, y.error()};
+        }
+    };
+} // namespace monad
+#endif